@@ -0,0 +1,185 @@
+#include "harness.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string_view>
+
+namespace Bench {
+
+struct Benchmark {
+    std::string name;
+    uint64_t items;
+    SetupFn setup;
+};
+
+using Clock = std::chrono::steady_clock;
+
+/// @brief Shortest time to measure at once. Shorter runs are repeated within each sample.
+static constexpr double MIN_SAMPLE_NS = 1e6;
+
+static std::vector<Benchmark> m_benchmarks;
+static volatile uint64_t m_sink = 0;
+
+static double ElapsedNs(Clock::time_point begin) {
+    return std::chrono::duration<double, std::nano>(Clock::now() - begin).count();
+}
+
+/** @return The nearest-rank percentile of sorted samples */
+static double Percentile(const std::vector<double>& sorted, double p) {
+    size_t rank = (size_t)std::ceil(p * sorted.size());
+    return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+}
+
+void Add(std::string name, uint64_t items, SetupFn setup) {
+    m_benchmarks.push_back({ std::move(name), items, std::move(setup) });
+}
+
+void Consume(uint64_t value) { m_sink = m_sink + value; }
+
+void List() {
+    for (const Benchmark& benchmark : m_benchmarks)
+        printf("%s\n", benchmark.name.c_str());
+}
+
+static Result Measure(const Benchmark& benchmark, const RunFn& run, const Options& options) {
+    // Warm up caches and allocations, and estimate the time of one run
+    uint64_t warmup_runs = 0;
+    Clock::time_point begin = Clock::now();
+    do {
+        run();
+        ++warmup_runs;
+    } while (ElapsedNs(begin) < options.warmup_time * 1e9);
+    const double estimate_ns = ElapsedNs(begin) / warmup_runs;
+
+    Result result;
+    result.name = benchmark.name;
+    result.items = benchmark.items;
+    result.runs_per_sample = std::max<uint64_t>(1, (uint64_t)(MIN_SAMPLE_NS / std::max(estimate_ns, 1.0)));
+
+    std::vector<double> samples;
+    double total_ns = 0;
+    while (samples.size() < options.min_samples
+        || (total_ns < options.min_time * 1e9 && samples.size() < options.max_samples)) {
+        begin = Clock::now();
+        for (uint64_t i = 0; i < result.runs_per_sample; ++i)
+            run();
+        const double sample_ns = ElapsedNs(begin);
+        total_ns += sample_ns;
+        samples.push_back(sample_ns / result.runs_per_sample);
+    }
+
+    std::sort(samples.begin(), samples.end());
+    result.samples = (uint32_t)samples.size();
+    result.min_ns = samples.front();
+    result.max_ns = samples.back();
+    result.p50_ns = Percentile(samples, 0.50);
+    result.p90_ns = Percentile(samples, 0.90);
+    result.p99_ns = Percentile(samples, 0.99);
+    result.mean_ns = total_ns / (samples.size() * result.runs_per_sample);
+    return result;
+}
+
+std::vector<Result> RunAll(const Options& options) {
+    std::vector<Result> results;
+    for (const Benchmark& benchmark : m_benchmarks) {
+        if (benchmark.name.find(options.filter) == std::string::npos)
+            continue;
+        RunFn run = benchmark.setup();
+        if (!run) {
+            fprintf(stderr, "Skipped %s\n", benchmark.name.c_str());
+            continue;
+        }
+        fprintf(stderr, "Running %s...\n", benchmark.name.c_str());
+        results.push_back(Measure(benchmark, run, options));
+    }
+    return results;
+}
+
+bool WriteJson(const std::vector<Result>& results, const char* path) {
+    const bool is_stdout = strcmp(path, "-") == 0;
+    FILE* file = is_stdout ? stdout : fopen(path, "w");
+    if (!file)
+        return false;
+
+    fputs("{\"benchmarks\":[\n", file);
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        fprintf(file, "{\"name\":\"%s\",\"items\":%llu,\"samples\":%u,\"runs_per_sample\":%llu,"
+            "\"min_ns\":%.1f,\"p50_ns\":%.1f,\"p90_ns\":%.1f,\"p99_ns\":%.1f,\"max_ns\":%.1f,\"mean_ns\":%.1f,\"items_per_second\":%.1f}%s\n",
+            r.name.c_str(), (unsigned long long)r.items, r.samples, (unsigned long long)r.runs_per_sample,
+            r.min_ns, r.p50_ns, r.p90_ns, r.p99_ns, r.max_ns, r.mean_ns, r.ItemsPerSecond(),
+            i + 1 < results.size() ? "," : "");
+    }
+    fputs("]}\n", file);
+
+    if (is_stdout)
+        return fflush(file) == 0;
+    return fclose(file) == 0;
+}
+
+bool ReadBaseline(const char* path, std::vector<Result>* out_results) {
+    std::ifstream file(path);
+    if (!file.is_open())
+        return false;
+
+    // Each benchmark is on its own line, as written by WriteJson
+    static constexpr std::string_view NAME_KEY = "\"name\":\"";
+    static constexpr std::string_view P50_KEY = "\"p50_ns\":";
+    std::string line;
+    while (std::getline(file, line)) {
+        size_t name_begin = line.find(NAME_KEY);
+        size_t p50_begin = line.find(P50_KEY);
+        if (name_begin == std::string::npos || p50_begin == std::string::npos)
+            continue;
+        name_begin += NAME_KEY.size();
+        Result result;
+        result.name = line.substr(name_begin, line.find('"', name_begin) - name_begin);
+        result.p50_ns = strtod(line.c_str() + p50_begin + P50_KEY.size(), nullptr);
+        out_results->push_back(std::move(result));
+    }
+    return true;
+}
+
+/** Format nanoseconds with a readable unit */
+static std::string FormatTime(double ns) {
+    char buf[32];
+    if (ns >= 1e9)
+        snprintf(buf, sizeof(buf), "%.2f s", ns / 1e9);
+    else if (ns >= 1e6)
+        snprintf(buf, sizeof(buf), "%.2f ms", ns / 1e6);
+    else if (ns >= 1e3)
+        snprintf(buf, sizeof(buf), "%.2f us", ns / 1e3);
+    else
+        snprintf(buf, sizeof(buf), "%.1f ns", ns);
+    return buf;
+}
+
+uint32_t PrintResults(const std::vector<Result>& results, const std::vector<Result>* baseline, double max_regression, FILE* out) {
+    uint32_t num_regressions = 0;
+    fprintf(out, "%-36s %10s %10s %10s %10s %14s%s\n", "benchmark", "min", "p50", "p90", "p99", "items/s", baseline ? "   vs baseline" : "");
+    for (const Result& r : results) {
+        fprintf(out, "%-36s %10s %10s %10s %10s %14.4g", r.name.c_str(),
+            FormatTime(r.min_ns).c_str(), FormatTime(r.p50_ns).c_str(),
+            FormatTime(r.p90_ns).c_str(), FormatTime(r.p99_ns).c_str(), r.ItemsPerSecond());
+
+        if (baseline) {
+            auto it = std::find_if(baseline->begin(), baseline->end(), [&](const Result& b) { return b.name == r.name; });
+            if (it == baseline->end() || it->p50_ns <= 0)
+                fprintf(out, "   (new)");
+            else {
+                const double change = r.p50_ns / it->p50_ns - 1.0;
+                const bool regressed = change > max_regression;
+                num_regressions += regressed;
+                fprintf(out, "   %+6.1f%%%s", change * 100.0, regressed ? "  REGRESSION" : "");
+            }
+        }
+        fprintf(out, "\n");
+    }
+    return num_regressions;
+}
+
+}
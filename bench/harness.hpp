@@ -0,0 +1,74 @@
+/**
+ * @file harness.hpp
+ * @brief Minimal micro-benchmark harness with warmup, percentiles, JSON output and baseline comparison
+ */
+
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace Bench {
+    /** One run of a benchmark. Each call should do the same amount of work. */
+    using RunFn = std::function<void()>;
+    /** Prepare a benchmark's state, and return the function that runs it. Only called if the benchmark is selected. */
+    using SetupFn = std::function<RunFn()>;
+
+    struct Options {
+        /// @brief Only run benchmarks whose names contain this
+        std::string filter;
+        /// @brief Seconds to run a benchmark before measuring it
+        double warmup_time = 0.1;
+        /// @brief Seconds to keep taking samples, once @ref min_samples are taken
+        double min_time = 0.5;
+        uint32_t min_samples = 10;
+        uint32_t max_samples = 1000;
+    };
+
+    struct Result {
+        std::string name;
+        /// @brief Items processed by each run, such as primitives or bytes
+        uint64_t items = 0;
+        uint32_t samples = 0;
+        /// @brief Runs timed together in each sample, so short runs aren't lost in the clock's resolution
+        uint64_t runs_per_sample = 0;
+        /// @brief Nanoseconds per run
+        double min_ns = 0, p50_ns = 0, p90_ns = 0, p99_ns = 0, max_ns = 0, mean_ns = 0;
+
+        double ItemsPerSecond() const { return p50_ns > 0 ? items * 1e9 / p50_ns : 0; }
+    };
+
+    /**
+     * @brief Register a benchmark
+     * @param name Unique name, with `/` between its group, case and size, such as `draw/rects/1000`
+     * @param items Items processed by each run, used for the throughput
+     */
+    void Add(std::string name, uint64_t items, SetupFn setup);
+    /** Run every registered benchmark that matches @ref Options::filter, in the order they were added */
+    std::vector<Result> RunAll(const Options& options);
+    /** Print the names of all registered benchmarks */
+    void List();
+
+    /**
+     * @brief Write results as JSON, with one benchmark object per line
+     * @param path File to write, or `-` for stdout
+     */
+    bool WriteJson(const std::vector<Result>& results, const char* path);
+    /**
+     * @brief Read results written by @ref WriteJson. Only names and medians are read.
+     * @return `false` if the file couldn't be opened
+     */
+    bool ReadBaseline(const char* path, std::vector<Result>* out_results);
+    /**
+     * @brief Print a table of results, and their change from a baseline if one is given
+     * @param max_regression Medians more than this fraction slower than the baseline are flagged
+     * @param out Stream to print to
+     * @return Number of flagged benchmarks
+     */
+    uint32_t PrintResults(const std::vector<Result>& results, const std::vector<Result>* baseline, double max_regression, FILE* out = stdout);
+
+    /** Keep the compiler from optimizing away a computed value */
+    void Consume(uint64_t value);
+}
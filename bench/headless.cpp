@@ -0,0 +1,48 @@
+/**
+ * @file headless.cpp
+ * @brief Stand-ins for the window platform and GL context, so benchmarks run on machines without either
+ */
+
+#include "headless.hpp"
+#include <platform.hpp>
+#include <render/opengl/opengl.hpp>
+#include <cstdio>
+
+namespace Platform {
+
+void Warning(std::string_view msg, const char* file, int line) {
+    fprintf(stderr, "[!] %.*s\n", (int)msg.length(), msg.data());
+    if (file)
+        fprintf(stderr, "\t(file \"%s\", line %d)\n", file, line);
+}
+
+void Error(std::string_view msg, const char* file, int line) {
+    Warning(msg, file, line);
+}
+
+}
+
+static GLuint m_next_texture = 1;
+
+static GLenum GLAD_API_PTR NullGetError() { return GL_NO_ERROR; }
+static void GLAD_API_PTR NullGenTextures(GLsizei n, GLuint* textures) {
+    for (GLsizei i = 0; i < n; ++i)
+        textures[i] = m_next_texture++;
+}
+static void GLAD_API_PTR NullDeleteTextures(GLsizei, const GLuint*) {}
+static void GLAD_API_PTR NullBindTexture(GLenum, GLuint) {}
+static void GLAD_API_PTR NullTexParameteri(GLenum, GLenum, GLint) {}
+static void GLAD_API_PTR NullPixelStorei(GLenum, GLint) {}
+static void GLAD_API_PTR NullTexImage2D(GLenum, GLint, GLint, GLsizei, GLsizei, GLint, GLenum, GLenum, const void*) {}
+static void GLAD_API_PTR NullTexSubImage2D(GLenum, GLint, GLint, GLint, GLsizei, GLsizei, GLenum, GLenum, const void*) {}
+
+void SetupHeadlessGl() {
+    glad_glGetError = NullGetError;
+    glad_glGenTextures = NullGenTextures;
+    glad_glDeleteTextures = NullDeleteTextures;
+    glad_glBindTexture = NullBindTexture;
+    glad_glTexParameteri = NullTexParameteri;
+    glad_glPixelStorei = NullPixelStorei;
+    glad_glTexImage2D = NullTexImage2D;
+    glad_glTexSubImage2D = NullTexSubImage2D;
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+/**
+ * @brief Point the GL functions used to create textures at no-ops, so fonts and textures can be created without a context.
+ * Drawing only records geometry, so it needs no GL at all. Anything that calls other GL functions will crash.
+ */
+void SetupHeadlessGl();
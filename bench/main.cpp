@@ -0,0 +1,447 @@
+/**
+ * @file main.cpp
+ * @brief Headless benchmarks of the CPU-side hot paths: drawing, submitting, reordering, fonts, packing, textures and hashing.
+ *
+ * Usage: glap_bench [--filter <text>] [--json <path|->] [--baseline <path>] [--max-regression <percent>]
+ *                   [--min-time <seconds>] [--samples <count>] [--list]
+ *
+ * Save a baseline with `--json baseline.json`, then compare a change against it with `--baseline baseline.json`.
+ * The exit code is `1` if any median is slower than the baseline by more than `--max-regression` percent.
+ */
+
+#include "harness.hpp"
+#include "headless.hpp"
+#include <render/render2d.hpp>
+#include <render/render2d_draw.hpp>
+#include <render/render2d_backend.hpp>
+#include <render/render2d_software.hpp>
+#include <render/reorder.hpp>
+#include <render/transform.hpp>
+#include <render/texture.hpp>
+#include <render/bake.hpp>
+#include <render/font/font.hpp>
+#include <render/font/fontatlas.hpp>
+#include <render/font/fontmanager.hpp>
+#include <resources/resource.hpp>
+#include <fnv1a.hpp>
+#include <glm/glm.hpp>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+static const char* FONT_URL = "Open_Sans/static/OpenSans-Regular.ttf";
+static constexpr uint32_t DRAW_SIZES[] = { 1'000, 10'000, 100'000, 1'000'000 };
+
+/** Small deterministic generator, so every run benchmarks the same data */
+struct Random {
+    uint32_t state = 0x9E3779B9;
+
+    uint32_t Next() {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+    uint32_t Range(uint32_t min, uint32_t max) { return min + Next() % (max - min + 1); }
+};
+
+/** Spread primitives over a 1080p screen */
+static glm::vec2 GridPos(uint32_t i) {
+    return glm::vec2((i % 256) * 7.5f, (i / 256 % 144) * 7.5f);
+}
+
+static glm::mat3 Rotation(float radians) {
+    const float c = std::cos(radians), s = std::sin(radians);
+    return glm::mat3(c, s, 0, -s, c, 0, 960, 540, 1);
+}
+
+/** @return The benchmark font, baked once, or `nullptr` if it couldn't be loaded */
+static FontHandle GetFont() {
+    static FontHandle font = [] {
+        FontHandle handle = FontManager::CreateFont(FontBakeConfig(FONT_URL, 32, 3));
+        FontManager::RunQueue();
+        return handle;
+    }();
+    return FontManager::GetAtlas(font) ? font : nullptr;
+}
+
+/**
+ * @brief Register one benchmark per size, each building a whole draw list per run
+ * @param build Called as `build(draw, count)` on a cleared draw
+ */
+template <class Fn>
+static void AddDraw(const char* name, uint32_t max_count, Fn build) {
+    for (uint32_t count : DRAW_SIZES) {
+        if (count > max_count)
+            break;
+        Bench::Add(std::string("draw/") + name + "/" + std::to_string(count), count, [=]() -> Bench::RunFn {
+            auto draw = std::make_shared<Render2d::Draw>();
+            return [=] {
+                draw->Clear();
+                build(*draw, count);
+                const Render2d::DrawList& list = draw->GetDrawList();
+                Bench::Consume(list.vertices.size() + list.quads.size() + list.calls.size());
+            };
+        });
+    }
+}
+
+static void AddDrawBenchmarks() {
+    AddDraw("rects", UINT32_MAX, [](Render2d::Draw& draw, uint32_t count) {
+        for (uint32_t i = 0; i < count; ++i) {
+            if (i % 64 == 0)
+                draw.SetColor(i % 3 / 2.f, i % 5 / 4.f, i % 7 / 6.f);
+            draw.Rect(GridPos(i), glm::vec2(6));
+        }
+    });
+    AddDraw("rects_indexed", UINT32_MAX, [](Render2d::Draw& draw, uint32_t count) {
+        draw.SetInstancedQuads(false);
+        for (uint32_t i = 0; i < count; ++i)
+            draw.Rect(GridPos(i), glm::vec2(6));
+    });
+    AddDraw("ellipses", UINT32_MAX, [](Render2d::Draw& draw, uint32_t count) {
+        for (uint32_t i = 0; i < count; ++i)
+            draw.Ellipse(GridPos(i), glm::vec2(6));
+    });
+    AddDraw("ellipses_tessellated", 100'000, [](Render2d::Draw& draw, uint32_t count) {
+        for (uint32_t i = 0; i < count; ++i)
+            draw.Ellipse(16, GridPos(i), glm::vec2(6));
+    });
+    AddDraw("nested_clips", UINT32_MAX, [](Render2d::Draw& draw, uint32_t count) {
+        // Every 64 primitives get a new stack of 3 clip rects
+        for (uint32_t i = 0; i < count; ++i) {
+            if (i % 64 == 0) {
+                if (i != 0) {
+                    for (int depth = 0; depth < 3; ++depth)
+                        draw.PopClip();
+                }
+                const glm::vec2 pos = GridPos(i);
+                for (int depth = 0; depth < 3; ++depth)
+                    draw.PushClip(glm::vec4(pos.x - 100 + depth * 10, pos.y - 100 + depth * 10, 400, 400));
+            }
+            draw.Rect(GridPos(i), glm::vec2(6));
+        }
+    });
+    AddDraw("transforms", UINT32_MAX, [](Render2d::Draw& draw, uint32_t count) {
+        // Rotations can't use quads, so this measures the triangle path and the bulk transform
+        for (uint32_t i = 0; i < count; ++i) {
+            if (i % 64 == 0) {
+                draw.PopTransform();
+                draw.PushTransform(Rotation(i * 0.001f));
+            }
+            draw.Rect(GridPos(i) - glm::vec2(960, 540), glm::vec2(6));
+        }
+    });
+
+    // Text is counted in glyphs, drawn in runs of 64
+    static constexpr std::string_view LINE = "The quick brown fox jumps over the lazy dog. 0123456789 ()[]{}!?";
+    static_assert(LINE.size() == 64);
+    for (uint32_t count : DRAW_SIZES) {
+        Bench::Add("draw/text/" + std::to_string(count), count / LINE.size() * LINE.size(), [=]() -> Bench::RunFn {
+            FontHandle font = GetFont();
+            if (!font)
+                return nullptr;
+            auto draw = std::make_shared<Render2d::Draw>();
+            return [=] {
+                draw->Clear();
+                for (uint32_t i = 0; i < count / LINE.size(); ++i)
+                    draw->TextAscii(font, glm::vec2(0, (i % 32) * 34.f), LINE);
+                Bench::Consume(draw->GetDrawList().quads.size() + draw->GetDrawList().vertices.size());
+            };
+        });
+    }
+}
+
+/** Build a list of mixed rects, triangles and clips, like a busy UI */
+static void BuildMixedList(Render2d::Draw& draw, uint32_t count) {
+    for (uint32_t i = 0; i < count; ++i) {
+        if (i % 256 == 0) {
+            if (i != 0)
+                draw.PopClip();
+            const glm::vec2 pos = GridPos(i);
+            draw.PushClip(glm::vec4(pos.x - 50, pos.y - 50, 600, 300));
+        }
+        // A run of triangles after every 3 runs of quads
+        if (i / 32 % 4 == 3)
+            draw.Ellipse(8, GridPos(i), glm::vec2(6));
+        else
+            draw.Rect(GridPos(i), glm::vec2(6));
+    }
+}
+
+/**
+ * @brief Register one benchmark per size, each submitting a built list through the Render2d functions per run
+ * @tparam T Backend that each benchmark selects with @ref Render2d::SetBackend
+ * @param after_render Called as `after_render(backend)` after each run, such as to reset the backend
+ */
+template <class T, class Fn>
+static void AddSubmit(const char* name, Fn after_render) {
+    for (uint32_t count : DRAW_SIZES) {
+        Bench::Add(std::string("submit/") + name + "/" + std::to_string(count), count, [=]() -> Bench::RunFn {
+            auto draw = std::make_shared<Render2d::Draw>();
+            BuildMixedList(*draw, count);
+            auto owned_backend = std::make_unique<T>();
+            T* backend = owned_backend.get();
+            Render2d::SetBackend(std::move(owned_backend));
+            Render2d::m_screen_w = 1920;
+            Render2d::m_screen_h = 1080;
+            return [=] {
+                Render2d::UploadDrawData(draw->GetDrawList());
+                Render2d::Render();
+                Bench::Consume(Render2d::GetFrameStats().texture_binds + Render2d::GetFrameStats().scissor_changes);
+                after_render(*backend);
+            };
+        });
+    }
+}
+
+static void AddSubmitBenchmarks() {
+    AddSubmit<Render2d::NullBackend>("null", [](Render2d::NullBackend&) {});
+    AddSubmit<Render2d::RecordingBackend>("recording", [](Render2d::RecordingBackend& backend) {
+        Bench::Consume(backend.GetRecording().size());
+        backend.ClearRecording();
+    });
+    AddSubmit<Render2d::SoftwareBackend>("software", [](Render2d::SoftwareBackend& backend) {
+        Bench::Consume(backend.GetTarget()->GetData()[0]);
+    });
+}
+
+static void AddReorderBenchmarks() {
+    for (uint32_t count : DRAW_SIZES) {
+        Bench::Add("reorder/mixed/" + std::to_string(count), count, [=]() -> Bench::RunFn {
+            auto draw = std::make_shared<Render2d::Draw>();
+            BuildMixedList(*draw, count);
+            auto list = std::make_shared<Render2d::DrawList>();
+            // Each run reorders a fresh copy. Debug builds also assert that no call moved past one it overlaps.
+            return [=] {
+                *list = draw->GetDrawList();
+                Bench::Consume(Render2d::ReorderCalls(*list));
+            };
+        });
+    }
+}
+
+static void AddTransformBenchmarks() {
+    static constexpr uint32_t COUNT = 1'000'000;
+    auto setup = []() {
+        auto vertices = std::make_shared<std::vector<Render2d::Vertex>>(COUNT);
+        Random random;
+        for (Render2d::Vertex& vertex : *vertices)
+            vertex = { (float)random.Range(0, 1920), (float)random.Range(0, 1080), 0, 0, 255, 255, 255, 255 };
+        return vertices;
+    };
+    // A rotation about the origin keeps the points from growing over many runs
+    const glm::mat3 tform = glm::mat3(0.8f, 0.6f, 0, -0.6f, 0.8f, 0, 0, 0, 1);
+
+    Bench::Add("transform/simd/" + std::to_string(COUNT), COUNT, [=]() -> Bench::RunFn {
+        auto vertices = setup();
+        return [=] {
+            Render2d::TransformPoints(&vertices->front().x, COUNT, sizeof(Render2d::Vertex), tform);
+            Bench::Consume((uint64_t)vertices->back().x);
+        };
+    });
+    Bench::Add("transform/scalar/" + std::to_string(COUNT), COUNT, [=]() -> Bench::RunFn {
+        auto vertices = setup();
+        return [=] {
+            Render2d::TransformPointsScalar(&vertices->front().x, COUNT, sizeof(Render2d::Vertex), tform);
+            Bench::Consume((uint64_t)vertices->back().x);
+        };
+    });
+}
+
+static void AddFontBenchmarks() {
+    const UnicodeRange range = UnicodeBlocks::BASIC_LATIN;
+    Bench::Add("font/atlas/32px", range.end - range.begin + 1, [=]() -> Bench::RunFn {
+        Resource::Ptr resource = Resource::Load(FONT_URL);
+        if (!resource)
+            return nullptr;
+        auto truetype = std::make_shared<std::optional<TrueType>>(TrueType::FromTrueType(resource));
+        if (!truetype->has_value())
+            return nullptr;
+        return [=] {
+            FontAtlas atlas(**truetype, FontBakeConfig(FONT_URL, 32, 3, range));
+            Bench::Consume(atlas.GetTexture()->GlHandle());
+        };
+    });
+
+    static constexpr uint32_t LOOKUPS = 1'000'000;
+    Bench::Add("font/codepoint_lookup/" + std::to_string(LOOKUPS), LOOKUPS, []() -> Bench::RunFn {
+        FontHandle font = GetFont();
+        if (!font)
+            return nullptr;
+        // Mostly mapped codepoints, with some misses outside the baked range
+        auto codepoints = std::make_shared<std::vector<codepoint_t>>(LOOKUPS);
+        Random random;
+        for (codepoint_t& codepoint : *codepoints)
+            codepoint = random.Range(0x20, 0x8F);
+        return [=] {
+            const FontCodepointMap& map = FontManager::GetAtlas(font)->GetCodepointMap();
+            uint64_t sum = 0;
+            uint32_t last_glyph = 0;
+            for (codepoint_t codepoint : *codepoints) {
+                const FontGlyphInfo* glyph = map.FindGlyph(codepoint);
+                if (!glyph)
+                    continue;
+                if (const int32_t* kerning = map.FindKerning(last_glyph, glyph->id))
+                    sum += *kerning;
+                sum += glyph->metrics.next_x_offset;
+                last_glyph = glyph->id;
+            }
+            Bench::Consume(sum);
+        };
+    });
+}
+
+static void AddPackerBenchmarks() {
+    for (uint32_t count : { 100u, 1'000u }) {
+        Bench::Add("packer/pack/" + std::to_string(count), count, [=]() -> Bench::RunFn {
+            auto sizes = std::make_shared<std::vector<std::pair<uint32_t, uint32_t>>>(count);
+            Random random;
+            for (auto& [w, h] : *sizes)
+                w = random.Range(4, 64), h = random.Range(4, 64);
+            return [=] {
+                RectPacker packer;
+                for (const auto& [w, h] : *sizes)
+                    packer.AddRect(w, h);
+                packer.Pack();
+                uint32_t w, h;
+                packer.GetPackedSize(&w, &h);
+                Bench::Consume(w * h);
+            };
+        });
+    }
+}
+
+static void AddTextureBenchmarks() {
+    static constexpr uint32_t SIZE = 1024;
+    static constexpr uint32_t TILE = 32;
+
+    Bench::Add("texture/convert/" + std::to_string(SIZE), SIZE * SIZE, []() -> Bench::RunFn {
+        ClientTexturePtr alpha = ClientTexture::Create(TextureInfo(TextureFormat::A_8_8, SIZE, SIZE));
+        memset(alpha->GetData(), 0x80, SIZE * SIZE);
+        return [=] {
+            // The same expansion as glyph bitmaps: white, with the source as alpha
+            ClientTexturePtr rgba = alpha->Convert(TextureFormat::RGBA_8_32, [](std::array<uint8_t, 4> input, std::array<uint8_t, 4>& output) {
+                output = { 0xFF, 0xFF, 0xFF, input[0] };
+            });
+            Bench::Consume(rgba->GetData()[3]);
+        };
+    });
+    Bench::Add("texture/write/" + std::to_string(SIZE), SIZE * SIZE, []() -> Bench::RunFn {
+        ClientTexturePtr atlas = ClientTexture::Create(TextureInfo(TextureFormat::RGBA_8_32, SIZE, SIZE));
+        ClientTexturePtr tile = ClientTexture::Create(TextureInfo(TextureFormat::RGBA_8_32, TILE, TILE));
+        memset(tile->GetData(), 0xFF, TILE * TILE * 4);
+        return [=] {
+            for (uint32_t y = 0; y < SIZE; y += TILE) {
+                for (uint32_t x = 0; x < SIZE; x += TILE)
+                    atlas->Write(tile, x, y);
+            }
+            Bench::Consume(atlas->GetData()[0]);
+        };
+    });
+}
+
+static void AddHashBenchmarks() {
+    for (uint32_t size : { 64u, 4'096u, 1'048'576u }) {
+        auto setup = [=]() {
+            auto bytes = std::make_shared<std::vector<uint8_t>>(size);
+            Random random;
+            for (uint8_t& byte : *bytes)
+                byte = (uint8_t)random.Next();
+            return bytes;
+        };
+        Bench::Add("fnv1a/hash32/" + std::to_string(size), size, [=]() -> Bench::RunFn {
+            auto bytes = setup();
+            return [=] { Bench::Consume(fnv1a::Hash_32(bytes->size(), bytes->data())); };
+        });
+        Bench::Add("fnv1a/hash64/" + std::to_string(size), size, [=]() -> Bench::RunFn {
+            auto bytes = setup();
+            return [=] { Bench::Consume(fnv1a::Hash_64(bytes->size(), bytes->data())); };
+        });
+    }
+}
+
+static void PrintUsage() {
+    printf(
+        "Usage: glap_bench [options]\n"
+        "  --filter <text>           Only run benchmarks whose names contain <text>\n"
+        "  --json <path>             Write results as JSON to <path>, or to stdout with -\n"
+        "  --baseline <path>         Compare medians with results from an earlier --json\n"
+        "  --max-regression <pct>    Fail if a median is this much slower than the baseline (default 5)\n"
+        "  --min-time <seconds>      Time to spend sampling each benchmark (default 0.5)\n"
+        "  --samples <count>         Minimum samples of each benchmark (default 10)\n"
+        "  --list                    List benchmarks and exit\n"
+    );
+}
+
+int main(int argc, char** argv) {
+    Bench::Options options;
+    const char* json_path = nullptr;
+    const char* baseline_path = nullptr;
+    double max_regression = 0.05;
+    bool list = false;
+
+    for (int i = 1; i < argc; ++i) {
+        const bool has_value = i + 1 < argc;
+        if (!strcmp(argv[i], "--filter") && has_value)
+            options.filter = argv[++i];
+        else if (!strcmp(argv[i], "--json") && has_value)
+            json_path = argv[++i];
+        else if (!strcmp(argv[i], "--baseline") && has_value)
+            baseline_path = argv[++i];
+        else if (!strcmp(argv[i], "--max-regression") && has_value)
+            max_regression = atof(argv[++i]) / 100.0;
+        else if (!strcmp(argv[i], "--min-time") && has_value)
+            options.min_time = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--samples") && has_value)
+            options.min_samples = (uint32_t)atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--list"))
+            list = true;
+        else {
+            PrintUsage();
+            return 2;
+        }
+    }
+
+    SetupHeadlessGl();
+
+    AddDrawBenchmarks();
+    AddSubmitBenchmarks();
+    AddReorderBenchmarks();
+    AddTransformBenchmarks();
+    AddFontBenchmarks();
+    AddPackerBenchmarks();
+    AddTextureBenchmarks();
+    AddHashBenchmarks();
+
+    if (list) {
+        Bench::List();
+        return 0;
+    }
+
+    std::vector<Bench::Result> baseline;
+    if (baseline_path && !Bench::ReadBaseline(baseline_path, &baseline)) {
+        fprintf(stderr, "Failed to read baseline %s\n", baseline_path);
+        return 2;
+    }
+
+    std::vector<Bench::Result> results = Bench::RunAll(options);
+    // Keep stdout clean when it's used for JSON
+    const bool json_to_stdout = json_path && !strcmp(json_path, "-");
+    uint32_t num_regressions = Bench::PrintResults(results, baseline_path ? &baseline : nullptr, max_regression,
+        json_to_stdout ? stderr : stdout);
+    if (json_path && !Bench::WriteJson(results, json_path)) {
+        fprintf(stderr, "Failed to write %s\n", json_path);
+        return 2;
+    }
+
+    FontManager::Cleanup();
+    return num_regressions ? 1 : 0;
+}
@@ -2,15 +2,21 @@
 #include <render/font/font.hpp>
 #include "glm/ext/scalar_constants.hpp"
 #include "platform.hpp"
+#include "profiler.hpp"
+#include "renderstats.hpp"
 #include <render/texture.hpp>
 #include <render/font/fontmanager.hpp>
 #include <glm/glm.hpp>
 #include <cmath>
 #include <render/opengl/setup.hpp>
+#include <render/opengl/oglstate.hpp>
 
 // Temporary includes for testing
 #include "input/inputqueue.hpp"
 #include "render/render2d.hpp"
+#include "render/render2d_backend.hpp"
+#include "render/render2d_software.hpp"
+#include "render/reorder.hpp"
 #include <chrono>
 #include <string>
 #include <vector>
@@ -33,11 +39,29 @@ void App::OnSetup() {
     OglSetup();
     ImGui_ImplOpenGL3_Init();
     Platform::SetInputHandler(&input_queue);
+    // The null backend skips the driver, to show how much of the frame is spent before it.
+    // The software backend draws on the CPU, for drivers that can't run the GL backend.
+    if (const char* backend = std::getenv("GLAP_RENDER_BACKEND")) {
+        if (!strcmp(backend, "null"))
+            Render2d::SetBackend(std::make_unique<Render2d::NullBackend>());
+        else if (!strcmp(backend, "software")) {
+            auto software = std::make_unique<Render2d::SoftwareBackend>();
+            software->present = true;
+            Render2d::SetBackend(std::move(software));
+        } else if (strcmp(backend, "gl"))
+            PLATFORM_WARNING(std::string("Unknown render backend: ") + backend);
+    }
     Render2d::Setup();
+    draw_gui.SetCpuClipping(true);
     Dialog::OnSetup();
     ImGui::GetIO().ConfigFlags |= ImGuiConfigFlags_DockingEnable;
     font_default = FontManager::CreateFont(FontBakeConfig("Open_Sans/static/OpenSans-Regular.ttf", 32, 3));
 
+    if (const char* stats_path = std::getenv("GLAP_RENDER_STATS")) {
+        if (!RenderStats::StartExport(stats_path))
+            PLATFORM_WARNING(std::string("Failed to open render stats export: ") + stats_path);
+    }
+
     Platform::AddRepeatingTask([] {
         FontManager::RunQueue();
         Platform::PreRender();
@@ -48,6 +72,8 @@ void App::OnSetup() {
 }
 
 void App::OnCleanup() {
+    RenderStats::StopExport();
+    Profiler::Cleanup();
     Render2d::Cleanup();
     FontManager::Cleanup();
     ImGui_ImplOpenGL3_Shutdown();
@@ -55,6 +81,7 @@ void App::OnCleanup() {
 }
 
 void App::Render() {
+    PROFILE_ZONE("App::Render");
     input_queue.Flush([](const hid::Event& e) {
         // TODO: Use this input when necessary.
         // DearImGui's input state suffices at the moment.
@@ -70,17 +97,25 @@ void App::Render() {
     draw_gui.Rect(0, 0, width, height);
     Dialog::OnDrawGui(draw_gui);
 
-    size_t num_drawcalls = draw_gui.GetDrawList().calls.size();
+    // Reordering needs a finished list, so the text shows the counts of the previous frame
+    static size_t num_drawcalls = 0;
+    static size_t num_saved_drawcalls = 0;
     draw_gui.ResetColor();
     draw_gui.TextAscii(font_default, glm::vec2(32, 50),
         std::to_string(num_drawcalls) + " draw calls\n"
+        + std::to_string(num_saved_drawcalls) + " saved by reordering\n"
     );
+    num_saved_drawcalls = Render2d::ReorderCalls(draw_gui.GetDrawList());
+    num_drawcalls = draw_gui.GetDrawList().calls.size();
 
     Render2d::m_screen_w = width;
     Render2d::m_screen_h = height;
+    static const auto start_time = std::chrono::steady_clock::now();
+    Render2d::m_time = std::chrono::duration<float>(std::chrono::steady_clock::now() - start_time).count();
     Render2d::render_target = nullptr;
     Render2d::UploadDrawData(draw_gui.GetDrawList());
     Render2d::Render();
+    RenderStats::Record(Render2d::GetFrameStats());
 
     ImGui_ImplOpenGL3_NewFrame();
     ImGui::NewFrame();
@@ -115,15 +150,29 @@ void App::Render() {
 
     ImGui::DockSpace(dock_space_id);
     Dialog::OnImGui();
+    Profiler::OnImGui();
+    RenderStats::OnImGui();
     if (ImGui::Begin("Viewport", nullptr, ImGuiWindowFlags_NoBackground))
     {
         bool viewport_input = ImGui::IsWindowHovered();
         Dialog::OnImGuiViewport(viewport_input);
+
+        bool stream_uploads = Render2d::upload_mode == Render2d::UploadMode::STREAM;
+        if (ImGui::Checkbox("Stream uploads", &stream_uploads))
+            Render2d::upload_mode = stream_uploads ? Render2d::UploadMode::STREAM : Render2d::UploadMode::CHANGES;
+        ImGui::SameLine();
+        const Render2d::UploadStats& upload = Render2d::GetUploadStats();
+        ImGui::Text("Uploaded %zu KB, skipped %zu KB (%u full, %u partial, %u unchanged, %u fence waits)",
+            upload.bytes_uploaded / 1024, upload.bytes_skipped / 1024,
+            upload.full_uploads, upload.partial_uploads, upload.skipped_uploads, upload.fence_waits);
+        const OglState::Stats& state = OglState::GetStats();
+        ImGui::Text("GL state changes: %u issued, %u skipped", state.issued, state.skipped);
     }
     ImGui::End();
     
     ImGui::End();
 
+    PROFILE_GPU_ZONE("ImGui");
     ImGui::Render();
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 }
@@ -4,12 +4,20 @@
 #include <vector>
 #include <unordered_map>
 #include <cstdint>
+#include <algorithm>
 #include <memory>
 #include <imgui_internal.h>
 #include <misc/cpp/imgui_stdlib.h>
+#include <render/render2d.hpp>
 #include <render/render2d_draw.hpp>
+#include <render/render2d_fragment.hpp>
+#include <render/font/fontmanager.hpp>
+#include <render/font/fontatlas.hpp>
+#include <fnv1a.hpp>
 #include <glm/ext/matrix_transform.hpp>
 #include <util/defer.hpp>
+#include <util/parallel.hpp>
+#include <util/spatial_grid.hpp>
 #include <render/opengl/oglshader.hpp>
 
 namespace Dialog {
@@ -22,6 +30,10 @@ static const int NODE_HEIGHT = GRID_SIZE;
 static const int NODE_WIDTH = GRID_SIZE*4;
 static const float VIEWPORT_SCALE_MAX = 8.f;
 static const float VIEWPORT_SCALE_MIN = 1.f/8;
+/// @brief Minimum number of nodes that each thread builds at once
+static const size_t NODES_PER_PIECE = 256;
+/// @brief Cell size of the graph's spatial index, in world units
+static const float NODE_CELL_SIZE = GRID_SIZE*8;
 
 static OglProgramPtr grid_shader;
 static glm::vec2 viewport_origin{0.f};
@@ -35,10 +47,14 @@ struct Span {
 };
 
 struct Node {
+    /// @brief Unique and increasing in the order that nodes were added, which is also their draw order
+    uint32_t id = 0;
     std::string name;
     std::string desc;
     std::vector<Span> spans;
     glm::vec2 pos{0.f};
+    /// @brief The node's box and label, recorded at its local origin
+    Render2d::DrawFragment fragment;
 };
 
 using NodePtr = std::weak_ptr<Node>;
@@ -46,6 +62,8 @@ using NodePtr = std::weak_ptr<Node>;
 struct Graph {
     NodePtr root;
     std::vector<std::shared_ptr<Node>> nodes;
+    /// @brief Node rectangles, for picking and culling without visiting every node
+    SpatialGrid<std::shared_ptr<Node>> index{NODE_CELL_SIZE};
     float next_y = 0;
     uint32_t next_name = 0;
 
@@ -53,10 +71,11 @@ struct Graph {
         nodes.emplace_back(std::make_shared<Node>());
         std::shared_ptr<Node> node = nodes.back();
         
+        node->id = next_name;
         node->name = std::to_string(next_name);
         ++next_name;
 
-        node->pos.y = next_y;
+        MoveNode(node, glm::vec2{0.f, next_y});
         next_y += GRID_SIZE;
         return node;
     }
@@ -65,16 +84,35 @@ struct Graph {
         std::shared_ptr<Node> node = node_ptr.lock();
         for (size_t i = 0; i < nodes.size(); ++i) {
             if (node == nodes[i]) {
+                index.Remove(node);
                 nodes.erase(nodes.begin() + i);
                 return true;
             }
         }
         return false;
     }
+
+    void MoveNode(const std::shared_ptr<Node>& node, glm::vec2 pos) {
+        node->pos = pos;
+        index.Update(node, pos, pos + glm::vec2{NODE_WIDTH, NODE_HEIGHT});
+    }
+
+    /// @brief Find the nodes within a world rect, sorted by draw order
+    void FindNodes(glm::vec2 min, glm::vec2 max, std::vector<std::shared_ptr<Node>>& out) const {
+        out.clear();
+        index.Query(min, max, [&](const std::shared_ptr<Node>& node) { out.emplace_back(node); });
+        std::sort(out.begin(), out.end(), [](const std::shared_ptr<Node>& a, const std::shared_ptr<Node>& b) {
+            return a->id < b->id;
+        });
+    }
 };
 
 static Graph graph;
 static NodePtr selected_node_ptr;
+/// @brief Node geometry built in parallel, one draw per piece of the graph
+static std::vector<Render2d::Draw> node_draws;
+/// @brief Nodes found by the last query of the graph's index
+static std::vector<std::shared_ptr<Node>> found_nodes;
 
 void DrawNode(Render2d::Draw& draw, std::shared_ptr<Node> node);
 glm::mat3 ViewToWorld();
@@ -146,14 +184,9 @@ void OnImGuiViewport(bool viewport_input) {
     std::shared_ptr<Node> hovered_node;
     glm::mat3 to_world = ViewToWorld();
     glm::vec2 mouse_world = glm::vec2{to_world * glm::vec3{io.MousePos.x, io.MousePos.y, 1.f}};
-    for (std::shared_ptr<Node> node : graph.nodes) {
-        int left = node->pos.x, top = node->pos.y;
-        int right = left + NODE_WIDTH, bottom = top + NODE_HEIGHT;
-        if (mouse_world.x >= left && mouse_world.x <= right && mouse_world.y >= top && mouse_world.y <= bottom) {
-            hovered_node = node;
-            break;
-        }
-    }
+    graph.FindNodes(mouse_world, mouse_world, found_nodes);
+    if (!found_nodes.empty())
+        hovered_node = found_nodes.front(); // The earliest node is drawn on top
     
     // Only handle one mouse button in a frame
     int mbtn_down = -1;
@@ -178,9 +211,10 @@ void OnImGuiViewport(bool viewport_input) {
     std::shared_ptr<Node> selected_node = selected_node_ptr.lock();
     if (selected_node != nullptr) {
         if (mbtn_down == ImGuiMouseButton_Left) {
-            selected_node->pos = glm::floor(eclick_world + mouse_world - mclick_world + GRID_SIZE/2);
-            selected_node->pos.x -= (int32_t)selected_node->pos.x % (int32_t)GRID_SIZE;
-            selected_node->pos.y -= (int32_t)selected_node->pos.y % (int32_t)GRID_SIZE;
+            glm::vec2 pos = glm::floor(eclick_world + mouse_world - mclick_world + GRID_SIZE/2);
+            pos.x -= (int32_t)pos.x % (int32_t)GRID_SIZE;
+            pos.y -= (int32_t)pos.y % (int32_t)GRID_SIZE;
+            graph.MoveNode(selected_node, pos);
         }
     }
 
@@ -239,26 +273,62 @@ void OnDrawGui(Render2d::Draw& draw) {
     defer { draw.PopTransform(); };
 
     std::shared_ptr<Node> selected_node = selected_node_ptr.lock();
-    
-    for (size_t i = graph.nodes.size(); i > 0; --i) {
-        if (graph.nodes[i-1] == selected_node)
-            continue; // Save this for last
-        DrawNode(draw, graph.nodes[i-1]);
-    }
-    if (selected_node != nullptr)
+
+    // Only build the nodes within the viewport
+    glm::mat3 to_world = ViewToWorld();
+    glm::vec2 view_min = glm::vec2{to_world * glm::vec3{viewport_pos, 1.f}};
+    glm::vec2 view_max = glm::vec2{to_world * glm::vec3{viewport_pos + viewport_size, 1.f}};
+    graph.FindNodes(view_min, view_max, found_nodes);
+    const bool is_selected_visible = selected_node != nullptr
+        && std::find(found_nodes.begin(), found_nodes.end(), selected_node) != found_nodes.end();
+
+    // Each piece is a consecutive run of nodes, in the same reverse order as drawing them serially
+    const size_t num_nodes = found_nodes.size();
+    const size_t num_pieces = std::clamp<size_t>(num_nodes / NODES_PER_PIECE, 1, GetParallelism());
+    node_draws.resize(num_pieces);
+    draw.AppendParallel(node_draws, [&](size_t piece, Render2d::Draw& piece_draw) {
+        size_t end = num_nodes - num_nodes * piece / num_pieces;
+        size_t begin = num_nodes - num_nodes * (piece + 1) / num_pieces;
+        for (size_t i = end; i > begin; --i) {
+            if (found_nodes[i-1] == selected_node)
+                continue; // Save this for last
+            DrawNode(piece_draw, found_nodes[i-1]);
+        }
+    });
+    if (is_selected_visible)
         DrawNode(draw, selected_node);
 }
 
 void DrawNode(Render2d::Draw& draw, std::shared_ptr<Node> node) {
-    draw.SetColor(1,1,1);
-    draw.Rect(node->pos.x, node->pos.y, NODE_WIDTH, NODE_HEIGHT);
-
-    glm::vec4 color = {0.f, 0.f, 0.f, 1.f};
-    if (node == selected_node_ptr.lock()) {
-        color = {1.f, 0.f, 0.f, 1.f};
+    const bool is_selected = node == selected_node_ptr.lock();
+
+    // Re-record only when the label, selection, or font atlas changes
+    const FontAtlas* atlas = FontManager::GetAtlas(App::font_default);
+    const Texture* atlas_tex = atlas ? atlas->GetTexture().get() : nullptr;
+    uint64_t key = fnv1a::Hash_64(node->name.size(), (const uint8_t*)node->name.data());
+    key = fnv1a::Hash_64(is_selected, key);
+    key = fnv1a::Hash_64(atlas_tex, key);
+
+    if (!node->fragment.IsCurrent(key)) {
+        Render2d::Draw& record = node->fragment.Record(key);
+        record.SetColor(1,1,1);
+        record.Rect(0, 0, NODE_WIDTH, NODE_HEIGHT);
+
+        glm::vec4 color = {0.f, 0.f, 0.f, 1.f};
+        if (is_selected) {
+            color = {1.f, 0.f, 0.f, 1.f};
+        }
+        record.SetColor(color);
+        record.TextAscii(App::font_default, glm::vec2{0.f}, node->name);
     }
-    draw.SetColor(color);
-    draw.TextAscii(App::font_default, node->pos, node->name);
+
+    draw.PushTransform(glm::mat3{
+        1.f, 0.f, 0.f,
+        0.f, 1.f, 0.f,
+        node->pos.x, node->pos.y, 1.f
+    });
+    draw.AppendFragment(node->fragment);
+    draw.PopTransform();
 }
 
 void OnInput() {
@@ -267,10 +337,10 @@ void OnInput() {
 
 static const char* GRID_SHADER_VERT =
 IMPL_GLSL_VERSION_HEADER
+RENDER2D_FRAME_CONSTANTS_GLSL
 R"(
 precision highp float;
 uniform mat3x3 transform;
-uniform vec2 resolution;
 in vec2 in_pos;
 in vec4 in_color;
 out vec2 frag_pos;
@@ -286,12 +356,12 @@ void main() {
 
 static const char* GRID_SHADER_FRAG =
 IMPL_GLSL_VERSION_HEADER
+RENDER2D_FRAME_CONSTANTS_GLSL
 R"(
 precision highp float;
 uniform float grid_size;
 uniform vec4 grid_col0;
 uniform vec4 grid_col1;
-uniform vec2 resolution;
 in vec2 frag_pos;
 in vec4 frag_color;
 out vec4 final_frag_color;
@@ -16,7 +16,7 @@ namespace fnv1a
         return HashTemplate<uint32_t>(length, data, initial_hash, prime_32);
     }
 
-    uint64_t Hash_64(size_t length, const uint8_t* data, uint32_t initial_hash) {
+    uint64_t Hash_64(size_t length, const uint8_t* data, uint64_t initial_hash) {
         return HashTemplate<uint64_t>(length, data, initial_hash, prime_64);
     }
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "platform.hpp"
 #include "app.hpp"
+#include "profiler.hpp"
 #include <list>
 #include <cstdio>
 #include <cassert>
@@ -35,15 +36,20 @@ bool RunTasksOnce() {
     if (ShouldClose())
         return false;
     
-    auto it = repeat_tasks.begin();
-    while (it != repeat_tasks.end()) {
-        RepeatTaskCallback callback = *it;
-        bool result = callback();
-        if (!result)
-            it = repeat_tasks.erase(it);
-        else
-            ++it;
+    Profiler::BeginFrame();
+    {
+        PROFILE_ZONE("Platform::RunTasksOnce");
+        auto it = repeat_tasks.begin();
+        while (it != repeat_tasks.end()) {
+            RepeatTaskCallback callback = *it;
+            bool result = callback();
+            if (!result)
+                it = repeat_tasks.erase(it);
+            else
+                ++it;
+        }
     }
+    Profiler::EndFrame();
 
     return !repeat_tasks.empty();
 }
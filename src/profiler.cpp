@@ -0,0 +1,343 @@
+#include "profiler.hpp"
+
+#if GLAP_PROFILER
+#include <render/opengl/opengl.hpp>
+#include <fnv1a.hpp>
+#include <imgui.h>
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cfloat>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <utility>
+
+namespace Profiler {
+
+struct OpenZone {
+    const char* name;
+    uint64_t begin_ns;
+};
+
+struct GpuQuery {
+    GLuint query;
+    const char* name;
+    uint64_t frame;
+    uint64_t begin_ns;
+};
+
+static const auto m_epoch = std::chrono::steady_clock::now();
+static std::atomic<uint32_t> m_next_thread_id = 0;
+static thread_local uint32_t t_thread_id = m_next_thread_id++;
+static thread_local std::vector<OpenZone> t_open_zones;
+
+// Zones may end on any thread, so they're collected here until the frame ends
+static std::mutex m_mutex;
+static std::vector<Zone> m_ended_zones;
+
+static std::deque<Frame> m_frames;
+static Frame m_frame = {};
+static uint64_t m_frame_count = 0;
+static uint32_t m_main_thread = 0;
+static bool m_paused = false;
+
+// WebGL2 only has timer queries through an extension, which isn't loaded
+#ifndef __EMSCRIPTEN__
+static std::vector<GLuint> m_free_queries;
+static std::vector<GpuQuery> m_pending_queries;
+static GpuQuery m_active_query = {};
+static bool m_is_gpu_active = false;
+/// @brief GPU zones opened inside the active one, which aren't timed
+static uint32_t m_skipped_gpu_zones = 0;
+#endif
+
+// Viewer state
+static int m_selected_frame = -1;
+static std::string m_export_status;
+
+static uint64_t Now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_epoch).count();
+}
+
+uint32_t GetThreadId() { return t_thread_id; }
+
+void BeginZone(const char* name) {
+    t_open_zones.push_back({ name, Now() });
+}
+
+void EndZone() {
+    const uint64_t end_ns = Now();
+    assert(!t_open_zones.empty() && "EndZone called without BeginZone");
+    const OpenZone open = t_open_zones.back();
+    t_open_zones.pop_back();
+
+    std::lock_guard lock(m_mutex);
+    m_ended_zones.push_back({ open.name, open.begin_ns, end_ns, t_thread_id, (uint32_t)t_open_zones.size() });
+}
+
+void BeginGpuZone(const char* name) {
+#ifndef __EMSCRIPTEN__
+    if (m_is_gpu_active) {
+        ++m_skipped_gpu_zones;
+        return;
+    }
+
+    GLuint query;
+    if (!m_free_queries.empty()) {
+        query = m_free_queries.back();
+        m_free_queries.pop_back();
+    } else
+        glGenQueries(1, &query);
+
+    glBeginQuery(GL_TIME_ELAPSED, query);
+    m_active_query = { query, name, m_frame.index, Now() };
+    m_is_gpu_active = true;
+#endif
+}
+
+void EndGpuZone() {
+#ifndef __EMSCRIPTEN__
+    if (m_skipped_gpu_zones) {
+        --m_skipped_gpu_zones;
+        return;
+    }
+
+    glEndQuery(GL_TIME_ELAPSED);
+    m_pending_queries.push_back(m_active_query);
+    m_is_gpu_active = false;
+#endif
+}
+
+#ifndef __EMSCRIPTEN__
+/** Add the results of any finished queries to their frames, without waiting on the GPU */
+static void CollectGpuQueries() {
+    size_t num_ready = 0;
+    for (const GpuQuery& pending : m_pending_queries) {
+        // Queries finish in the order they were issued
+        GLuint available = 0;
+        glGetQueryObjectuiv(pending.query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            break;
+
+        GLuint64 elapsed_ns = 0;
+        glGetQueryObjectui64v(pending.query, GL_QUERY_RESULT, &elapsed_ns);
+        m_free_queries.push_back(pending.query);
+        ++num_ready;
+
+        // Frames recorded while paused were dropped, so indices may have gaps
+        auto frame = std::find_if(m_frames.rbegin(), m_frames.rend(), [&](const Frame& f) { return f.index == pending.frame; });
+        if (frame != m_frames.rend())
+            frame->zones.push_back({ pending.name, pending.begin_ns, pending.begin_ns + elapsed_ns, GPU_THREAD, 0 });
+    }
+    m_pending_queries.erase(m_pending_queries.begin(), m_pending_queries.begin() + num_ready);
+}
+#endif
+
+void BeginFrame() {
+    m_main_thread = t_thread_id;
+    m_frame.index = m_frame_count++;
+    m_frame.begin_ns = Now();
+    m_frame.end_ns = 0;
+    m_frame.zones.clear();
+
+    // Zones that ended between frames belong to neither
+    std::lock_guard lock(m_mutex);
+    m_ended_zones.clear();
+}
+
+void EndFrame() {
+    m_frame.end_ns = Now();
+    {
+        std::lock_guard lock(m_mutex);
+        m_frame.zones.swap(m_ended_zones);
+        m_ended_zones.clear();
+    }
+
+    if (!m_paused) {
+        // Reuse the oldest frame's storage for the next one
+        std::vector<Zone> recycled;
+        if (m_frames.size() >= MAX_FRAMES) {
+            recycled = std::move(m_frames.front().zones);
+            m_frames.pop_front();
+        }
+        m_frames.push_back(std::move(m_frame));
+        m_frame.zones = std::move(recycled);
+    }
+
+#ifndef __EMSCRIPTEN__
+    CollectGpuQueries();
+#endif
+}
+
+void SetPaused(bool paused) { m_paused = paused; }
+bool IsPaused() { return m_paused; }
+const std::deque<Frame>& GetFrames() { return m_frames; }
+
+void Cleanup() {
+#ifndef __EMSCRIPTEN__
+    if (m_is_gpu_active) {
+        glEndQuery(GL_TIME_ELAPSED);
+        m_free_queries.push_back(m_active_query.query);
+        m_is_gpu_active = false;
+    }
+    for (const GpuQuery& pending : m_pending_queries)
+        m_free_queries.push_back(pending.query);
+    m_pending_queries.clear();
+    if (!m_free_queries.empty())
+        glDeleteQueries((GLsizei)m_free_queries.size(), m_free_queries.data());
+    m_free_queries.clear();
+#endif
+}
+
+static void WriteJsonString(FILE* file, const char* str) {
+    fputc('"', file);
+    for (; *str; ++str) {
+        if (*str == '"' || *str == '\\')
+            fputc('\\', file);
+        if ((unsigned char)*str >= 0x20)
+            fputc(*str, file);
+    }
+    fputc('"', file);
+}
+
+bool ExportChromeTrace(const char* path) {
+    FILE* file = fopen(path, "w");
+    if (!file)
+        return false;
+
+    // Trace events use microseconds. Every thread gets a named track.
+    std::vector<uint32_t> threads;
+    for (const Frame& frame : m_frames) {
+        for (const Zone& zone : frame.zones) {
+            if (std::find(threads.begin(), threads.end(), zone.thread) == threads.end())
+                threads.push_back(zone.thread);
+        }
+    }
+
+    fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", file);
+    bool first = true;
+    for (uint32_t thread : threads) {
+        std::string name = thread == GPU_THREAD ? "GPU" : thread == m_main_thread ? "Main" : "Thread " + std::to_string(thread);
+        fprintf(file, "%s{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":", first ? "" : ",\n", thread);
+        WriteJsonString(file, name.c_str());
+        fputs("}}", file);
+        first = false;
+    }
+    for (const Frame& frame : m_frames) {
+        for (const Zone& zone : frame.zones) {
+            fputs(first ? "{\"name\":" : ",\n{\"name\":", file);
+            WriteJsonString(file, zone.name);
+            fprintf(file, ",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"frame\":%llu}}",
+                zone.thread == GPU_THREAD ? "gpu" : "cpu", zone.thread,
+                zone.begin_ns / 1000.0, (zone.end_ns - zone.begin_ns) / 1000.0, (unsigned long long)frame.index);
+            first = false;
+        }
+    }
+    fputs("\n]}\n", file);
+
+    bool ok = !ferror(file);
+    return fclose(file) == 0 && ok;
+}
+
+/** Draw the zones of one thread as stacked bars, with the frame spanning the available width */
+static void DrawFlameTrack(const Frame& frame, uint32_t thread) {
+    const float bar_height = ImGui::GetTextLineHeight() + 2.f;
+    const float width = std::max(ImGui::GetContentRegionAvail().x, 1.f);
+    const double frame_ns = std::max<double>(frame.end_ns - frame.begin_ns, 1.0);
+    const ImVec2 origin = ImGui::GetCursorScreenPos();
+    ImDrawList* draw_list = ImGui::GetWindowDrawList();
+
+    uint32_t max_depth = 0;
+    for (const Zone& zone : frame.zones) {
+        if (zone.thread != thread)
+            continue;
+        max_depth = std::max(max_depth, zone.depth);
+
+        // GPU zones can run past the end of the frame
+        float x0 = origin.x + (float)(std::clamp<double>((double)zone.begin_ns - frame.begin_ns, 0.0, frame_ns) / frame_ns * width);
+        float x1 = origin.x + (float)(std::clamp<double>((double)zone.end_ns - frame.begin_ns, 0.0, frame_ns) / frame_ns * width);
+        x1 = std::max(x1, x0 + 1.f);
+        const ImVec2 min = { x0, origin.y + zone.depth * bar_height };
+        const ImVec2 max = { x1, min.y + bar_height - 1.f };
+
+        // Hash the name instead of its address, which differs between translation units
+        uint32_t hash = fnv1a::Hash_32(strlen(zone.name), (const uint8_t*)zone.name);
+        draw_list->AddRectFilled(min, max, ImColor::HSV((hash % 360) / 360.f, 0.5f, 0.7f));
+        draw_list->PushClipRect(min, max, true);
+        draw_list->AddText({ min.x + 2.f, min.y + 1.f }, IM_COL32_WHITE, zone.name);
+        draw_list->PopClipRect();
+
+        if (ImGui::IsMouseHoveringRect(min, max))
+            ImGui::SetTooltip("%s\n%.3f ms", zone.name, (zone.end_ns - zone.begin_ns) / 1e6);
+    }
+    ImGui::Dummy({ width, (max_depth + 1) * bar_height });
+}
+
+void OnImGui(bool* open) {
+    if (!ImGui::Begin("Profiler", open)) {
+        ImGui::End();
+        return;
+    }
+
+    if (ImGui::Checkbox("Pause", &m_paused) && !m_paused)
+        m_selected_frame = -1;
+    ImGui::SameLine();
+    if (ImGui::Button("Export trace")) {
+        const char* path = "profile_trace.json";
+        m_export_status = ExportChromeTrace(path) ? std::string("Wrote ") + path : std::string("Failed to write ") + path;
+    }
+    ImGui::SameLine();
+    ImGui::TextUnformatted(m_export_status.c_str());
+
+    if (m_frames.empty()) {
+        ImGui::TextUnformatted("No frames recorded");
+        ImGui::End();
+        return;
+    }
+
+    float frame_ms[MAX_FRAMES];
+    const int num_frames = (int)m_frames.size();
+    for (int i = 0; i < num_frames; ++i)
+        frame_ms[i] = (m_frames[i].end_ns - m_frames[i].begin_ns) / 1e6f;
+    ImGui::PlotHistogram("##frame_times", frame_ms, num_frames, 0, "Frame times (ms)", 0.f, FLT_MAX, { -1.f, 60.f });
+
+    // Clicking a frame pauses recording, so the frame stays put
+    if (ImGui::IsItemClicked()) {
+        float t = (ImGui::GetMousePos().x - ImGui::GetItemRectMin().x) / std::max(ImGui::GetItemRectSize().x, 1.f);
+        m_selected_frame = std::clamp((int)(t * num_frames), 0, num_frames - 1);
+        m_paused = true;
+    }
+    if (m_selected_frame >= num_frames)
+        m_selected_frame = -1;
+
+    const Frame& frame = m_frames[m_selected_frame < 0 ? num_frames - 1 : m_selected_frame];
+    ImGui::Text("Frame %llu: %.3f ms", (unsigned long long)frame.index, (frame.end_ns - frame.begin_ns) / 1e6);
+
+    std::vector<uint32_t> threads;
+    for (const Zone& zone : frame.zones) {
+        if (std::find(threads.begin(), threads.end(), zone.thread) == threads.end())
+            threads.push_back(zone.thread);
+    }
+    // Main thread first, GPU last
+    std::sort(threads.begin(), threads.end(), [](uint32_t a, uint32_t b) {
+        return std::make_pair(a != m_main_thread, a) < std::make_pair(b != m_main_thread, b);
+    });
+
+    for (uint32_t thread : threads) {
+        if (thread == GPU_THREAD)
+            ImGui::TextUnformatted("GPU");
+        else if (thread == m_main_thread)
+            ImGui::TextUnformatted("Main");
+        else
+            ImGui::Text("Thread %u", thread);
+        DrawFlameTrack(frame, thread);
+    }
+
+    ImGui::End();
+}
+
+}
+#endif
@@ -0,0 +1,124 @@
+/**
+ * @file profiler.hpp
+ * @brief Frame profiler with scoped CPU and GPU zones
+ *
+ * Zones are opened with @ref PROFILE_ZONE and @ref PROFILE_GPU_ZONE, and grouped into frames by
+ * @ref Profiler::BeginFrame and @ref Profiler::EndFrame. The last few frames are kept for
+ * @ref Profiler::OnImGui and @ref Profiler::ExportChromeTrace.
+ *
+ * The profiler is compiled in with the CMake option `GLAP_PROFILER`.
+ * Without it, the macros expand to nothing and the functions are empty.
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#define PROFILE_CONCAT_IMPL(A, B) A##B
+#define PROFILE_CONCAT(A, B) PROFILE_CONCAT_IMPL(A, B)
+
+#if GLAP_PROFILER
+/// @brief Time the rest of the enclosing scope on the CPU. `Name` must be a string literal.
+#define PROFILE_ZONE(Name) Profiler::ScopedZone PROFILE_CONCAT(profile_zone_, __LINE__)(Name)
+/// @brief Time the rest of the enclosing scope on both the CPU and GPU. `Name` must be a string literal.
+#define PROFILE_GPU_ZONE(Name) Profiler::ScopedGpuZone PROFILE_CONCAT(profile_zone_, __LINE__)(Name)
+#else
+#define PROFILE_ZONE(Name) ((void)0)
+#define PROFILE_GPU_ZONE(Name) ((void)0)
+#endif
+
+namespace Profiler {
+    /// @brief Thread ID of zones timed on the GPU
+    static constexpr uint32_t GPU_THREAD = UINT32_MAX;
+    /// @brief Number of frames kept for viewing and exporting
+    static constexpr size_t MAX_FRAMES = 240;
+
+    struct Zone {
+        /// @brief Static string given to the zone's macro
+        const char* name;
+        /// @brief Nanoseconds since the profiler started.
+        /// GPU zones begin when their commands were submitted, since GL doesn't say when they ran.
+        uint64_t begin_ns;
+        uint64_t end_ns;
+        /// @brief Small ID of the thread the zone ran on, or @ref GPU_THREAD
+        uint32_t thread;
+        /// @brief Number of enclosing zones on the same thread
+        uint32_t depth;
+    };
+
+    struct Frame {
+        uint64_t index;
+        uint64_t begin_ns;
+        uint64_t end_ns;
+        /// @brief Zones that ended during the frame, in the order they ended.
+        /// GPU zones are added a few frames later, once their queries are ready.
+        std::vector<Zone> zones;
+    };
+
+#if GLAP_PROFILER
+    /** Start a new frame. Call from the thread that owns the GL context. */
+    void BeginFrame();
+    /** Finish the current frame and collect any GPU timings that are ready */
+    void EndFrame();
+
+    void BeginZone(const char* name);
+    void EndZone();
+    /**
+     * @brief Start timing GPU commands with a `GL_TIME_ELAPSED` query.
+     * GL can't nest these queries, so a GPU zone inside another is only timed on the CPU.
+     */
+    void BeginGpuZone(const char* name);
+    void EndGpuZone();
+
+    /** Stop or resume recording frames, so the retained ones can be inspected */
+    void SetPaused(bool paused);
+    bool IsPaused();
+    /// @return Retained frames, oldest first
+    const std::deque<Frame>& GetFrames();
+    /// @return Small ID of the calling thread, as stored in @ref Zone::thread
+    uint32_t GetThreadId();
+
+    /**
+     * @brief Write the retained frames as Chrome trace-event JSON,
+     *  which can be opened with `chrome://tracing` or Perfetto.
+     * @return `false` if the file couldn't be written
+     */
+    bool ExportChromeTrace(const char* path);
+    /** Show the profiler window, with frame times and a flame view of one frame */
+    void OnImGui(bool* open = nullptr);
+    /** Release GPU queries. Call while the GL context is still current. */
+    void Cleanup();
+
+    class ScopedZone {
+    public:
+        explicit ScopedZone(const char* name) { BeginZone(name); }
+        ~ScopedZone() { EndZone(); }
+        ScopedZone(const ScopedZone&) = delete;
+        ScopedZone& operator=(const ScopedZone&) = delete;
+    };
+
+    class ScopedGpuZone {
+    public:
+        explicit ScopedGpuZone(const char* name) { BeginZone(name); BeginGpuZone(name); }
+        ~ScopedGpuZone() { EndGpuZone(); EndZone(); }
+        ScopedGpuZone(const ScopedGpuZone&) = delete;
+        ScopedGpuZone& operator=(const ScopedGpuZone&) = delete;
+    };
+#else
+    inline void BeginFrame() {}
+    inline void EndFrame() {}
+    inline void BeginZone(const char*) {}
+    inline void EndZone() {}
+    inline void BeginGpuZone(const char*) {}
+    inline void EndGpuZone() {}
+    inline void SetPaused(bool) {}
+    inline bool IsPaused() { return true; }
+    inline const std::deque<Frame>& GetFrames() { static const std::deque<Frame> frames; return frames; }
+    inline uint32_t GetThreadId() { return 0; }
+    inline bool ExportChromeTrace(const char*) { return false; }
+    inline void OnImGui(bool* = nullptr) {}
+    inline void Cleanup() {}
+#endif
+}
@@ -1,13 +1,10 @@
 #include "stb_rect_pack.h"
 #define STB_RECT_PACK_IMPLEMENTATION
 #include "bake.hpp"
+#include <profiler.hpp>
 #include <vector>
 #include <cmath>
 
-// Debugging
-#include <iostream>
-#include <chrono>
-
 uint32_t RectPacker::AddRect(uint32_t width, uint32_t height)
 {
     Rect rect = { 0 };
@@ -26,13 +23,13 @@ void RectPacker::Clear() {
 
 bool RectPacker::Pack()
 {
+    PROFILE_ZONE("RectPacker::Pack");
+
     // Constants
     const float padding_factor = 1.2;
     const float growth_factor = 1.2;
     const size_t max_iters = 1024;
 
-    auto time_begin = std::chrono::high_resolution_clock::now();
-
     uint32_t target_w = 0, target_h = 0;
 
     // Make a decent guess for the minimum size of the rectangle
@@ -48,11 +45,6 @@ bool RectPacker::Pack()
                 greatest_h = rect.h;
         }
         float square = std::sqrt(total_pixels);
-        float ratio = (float)target_w / target_h;
-
-        std::cout << "total px: " << target_w * target_h << std::endl;
-        std::cout << "square: " << square << std::endl;
-        std::cout << "ratio: " << ratio << std::endl;
 
         target_w = square;
         target_h = square;
@@ -66,9 +58,7 @@ bool RectPacker::Pack()
     // Padding
     target_w *= padding_factor, target_h *= padding_factor;
 
-    std::cout << "target_w: " << target_w << std::endl;
-    std::cout << "target_h: " << target_h << std::endl;
-    
+
     // Clamp to max heights
     if (target_w > m_max_w)
         target_w = m_max_w;
@@ -115,23 +105,5 @@ bool RectPacker::Pack()
             m_packed_h = rect.y + rect.h;
     }
     m_is_packed = result;
-
-    auto time_now = std::chrono::high_resolution_clock::now();
-
-    using duration_type = std::chrono::milliseconds;
-
-    auto duration = std::chrono::duration_cast<duration_type>(time_now - time_begin);
-    double duration_ms = ((double)duration.count() / duration_type::period::den) * duration_type::period::num;
-
-    std::cout << "packer tried " << iteration << " iterations" << std::endl;
-    std::cout << "m_is_packed: " << m_is_packed << std::endl;
-
-    if (!result)
-        return false;
-
-    std::cout << "Ended with " << target_w << "x" << target_h << " units" << std::endl;
-    std::cout << "Trimmed to " << m_packed_w << "x" << m_packed_h << " units" << std::endl;
-    std::cout << "Took " << duration_ms << " ms" << std::endl;
-    std::cout << "Extra memory used: " << (float)(nodes.size() * sizeof(nodes[0])) / 1024 << " KB" << std::endl;
-    return true;
+    return result;
 }
\ No newline at end of file
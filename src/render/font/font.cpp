@@ -85,12 +85,6 @@ void FontCodepointMap::AddCodepoint(const TrueType &truetype, codepoint_t codepo
     }
     
     truetype.GetGlyphMetrics(glyph.id, &glyph.metrics);
-    if (truetype.IsGlyphEmpty(glyph.id)) {
-        std::cout << "Huh, this valid glyph is actually empty!" << std::endl;
-        //std::cout << "advance = " << glyph->metrics.next_x_offset * m_scale << std::endl;
-    } else {
-        
-    }
 
     for (auto it = m_glyph_map.cbegin(); it != m_glyph_map.cend(); ++it) {
         uint32_t left = glyph.id, right = it->first;
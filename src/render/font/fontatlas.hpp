@@ -26,7 +26,7 @@ public:
     float GetScale() const { return m_scale; }
     uint8_t GetOversample() const { return m_oversample; }
     
-    TexturePtr GetTexture() const { return m_atlas_tex; }
+    const TexturePtr& GetTexture() const { return m_atlas_tex; }
 
     /**
      * @brief Get a glyph's texture rect.
@@ -3,6 +3,7 @@
 #include <unordered_map>
 #include <stack>
 #include <platform.hpp>
+#include <profiler.hpp>
 #include <resources/resource.hpp>
 
 static bool g_cleanup = false;
@@ -49,6 +50,7 @@ const FontAtlas* FontManager::GetAtlas(FontHandle handle) {
 }
 
 void FontManager::RunQueue() {
+    PROFILE_ZONE("FontManager::RunQueue");
     while (!GetQueue().empty()) {
         FontHandle handle = GetQueue().top();
         GetQueue().pop();
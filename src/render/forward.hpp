@@ -26,4 +26,5 @@ namespace Render2d {
     struct DrawCall;
     struct DrawList;
     class Draw;
+    class DrawFragment;
 }
\ No newline at end of file
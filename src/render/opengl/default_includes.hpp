@@ -1,2 +1,3 @@
 #pragma once
-#include <glad/gl.h>
\ No newline at end of file
+#include <glad/gl.h>
+#include "gl33.hpp"
\ No newline at end of file
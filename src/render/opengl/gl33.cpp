@@ -0,0 +1,38 @@
+/**
+ * @file
+ * @brief Load the OpenGL 3.1 - 3.3 entry points that glad doesn't
+ */
+
+#include "gl33.hpp"
+
+PFNGLCLIENTWAITSYNCPROC glap_glClientWaitSync = nullptr;
+PFNGLDELETESYNCPROC glap_glDeleteSync = nullptr;
+PFNGLDRAWARRAYSINSTANCEDPROC glap_glDrawArraysInstanced = nullptr;
+PFNGLFENCESYNCPROC glap_glFenceSync = nullptr;
+PFNGLGETACTIVEUNIFORMBLOCKNAMEPROC glap_glGetActiveUniformBlockName = nullptr;
+PFNGLGETACTIVEUNIFORMBLOCKIVPROC glap_glGetActiveUniformBlockiv = nullptr;
+PFNGLGETACTIVEUNIFORMSIVPROC glap_glGetActiveUniformsiv = nullptr;
+PFNGLGETQUERYOBJECTUI64VPROC glap_glGetQueryObjectui64v = nullptr;
+PFNGLUNIFORMBLOCKBINDINGPROC glap_glUniformBlockBinding = nullptr;
+PFNGLVERTEXATTRIBDIVISORPROC glap_glVertexAttribDivisor = nullptr;
+
+template <class Proc>
+static bool LoadProc(GLADloadfunc load, const char* name, Proc& proc) {
+    proc = reinterpret_cast<Proc>(load(name));
+    return proc != nullptr;
+}
+
+bool LoadGl33(GLADloadfunc load) {
+    bool is_complete = true;
+    is_complete &= LoadProc(load, "glClientWaitSync", glap_glClientWaitSync);
+    is_complete &= LoadProc(load, "glDeleteSync", glap_glDeleteSync);
+    is_complete &= LoadProc(load, "glDrawArraysInstanced", glap_glDrawArraysInstanced);
+    is_complete &= LoadProc(load, "glFenceSync", glap_glFenceSync);
+    is_complete &= LoadProc(load, "glGetActiveUniformBlockName", glap_glGetActiveUniformBlockName);
+    is_complete &= LoadProc(load, "glGetActiveUniformBlockiv", glap_glGetActiveUniformBlockiv);
+    is_complete &= LoadProc(load, "glGetActiveUniformsiv", glap_glGetActiveUniformsiv);
+    is_complete &= LoadProc(load, "glGetQueryObjectui64v", glap_glGetQueryObjectui64v);
+    is_complete &= LoadProc(load, "glUniformBlockBinding", glap_glUniformBlockBinding);
+    is_complete &= LoadProc(load, "glVertexAttribDivisor", glap_glVertexAttribDivisor);
+    return is_complete;
+}
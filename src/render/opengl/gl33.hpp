@@ -0,0 +1,58 @@
+#pragma once
+/**
+ * @file
+ * @brief OpenGL 3.1 - 3.3 entry points that the renderer uses on desktop.
+ * The generated glad loader in `deps/glad` only covers OpenGL 3.0, so these are declared and loaded by hand,
+ * in the same form as glad's own. Regenerating glad with `gl:core=3.3` makes this file unnecessary.
+ * OpenGL ES 3.0 and WebGL 2 already provide all of these.
+ */
+#include <glad/gl.h>
+
+#define GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH 0x8A35
+#define GL_ACTIVE_UNIFORM_BLOCKS 0x8A36
+#define GL_SYNC_FLUSH_COMMANDS_BIT 0x00000001
+#define GL_SYNC_GPU_COMMANDS_COMPLETE 0x9117
+#define GL_TIME_ELAPSED 0x88BF
+#define GL_TIMEOUT_EXPIRED 0x911B
+#define GL_UNIFORM_BLOCK_DATA_SIZE 0x8A40
+#define GL_UNIFORM_BLOCK_INDEX 0x8A3A
+#define GL_UNIFORM_BUFFER 0x8A11
+#define GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT 0x8A34
+
+typedef GLenum (GLAD_API_PTR *PFNGLCLIENTWAITSYNCPROC)(GLsync sync, GLbitfield flags, GLuint64 timeout);
+typedef void (GLAD_API_PTR *PFNGLDELETESYNCPROC)(GLsync sync);
+typedef void (GLAD_API_PTR *PFNGLDRAWARRAYSINSTANCEDPROC)(GLenum mode, GLint first, GLsizei count, GLsizei instancecount);
+typedef GLsync (GLAD_API_PTR *PFNGLFENCESYNCPROC)(GLenum condition, GLbitfield flags);
+typedef void (GLAD_API_PTR *PFNGLGETACTIVEUNIFORMBLOCKNAMEPROC)(GLuint program, GLuint uniformBlockIndex, GLsizei bufSize, GLsizei * length, GLchar * uniformBlockName);
+typedef void (GLAD_API_PTR *PFNGLGETACTIVEUNIFORMBLOCKIVPROC)(GLuint program, GLuint uniformBlockIndex, GLenum pname, GLint * params);
+typedef void (GLAD_API_PTR *PFNGLGETACTIVEUNIFORMSIVPROC)(GLuint program, GLsizei uniformCount, const GLuint * uniformIndices, GLenum pname, GLint * params);
+typedef void (GLAD_API_PTR *PFNGLGETQUERYOBJECTUI64VPROC)(GLuint id, GLenum pname, GLuint64 * params);
+typedef void (GLAD_API_PTR *PFNGLUNIFORMBLOCKBINDINGPROC)(GLuint program, GLuint uniformBlockIndex, GLuint uniformBlockBinding);
+typedef void (GLAD_API_PTR *PFNGLVERTEXATTRIBDIVISORPROC)(GLuint index, GLuint divisor);
+
+extern PFNGLCLIENTWAITSYNCPROC glap_glClientWaitSync;
+#define glClientWaitSync glap_glClientWaitSync
+extern PFNGLDELETESYNCPROC glap_glDeleteSync;
+#define glDeleteSync glap_glDeleteSync
+extern PFNGLDRAWARRAYSINSTANCEDPROC glap_glDrawArraysInstanced;
+#define glDrawArraysInstanced glap_glDrawArraysInstanced
+extern PFNGLFENCESYNCPROC glap_glFenceSync;
+#define glFenceSync glap_glFenceSync
+extern PFNGLGETACTIVEUNIFORMBLOCKNAMEPROC glap_glGetActiveUniformBlockName;
+#define glGetActiveUniformBlockName glap_glGetActiveUniformBlockName
+extern PFNGLGETACTIVEUNIFORMBLOCKIVPROC glap_glGetActiveUniformBlockiv;
+#define glGetActiveUniformBlockiv glap_glGetActiveUniformBlockiv
+extern PFNGLGETACTIVEUNIFORMSIVPROC glap_glGetActiveUniformsiv;
+#define glGetActiveUniformsiv glap_glGetActiveUniformsiv
+extern PFNGLGETQUERYOBJECTUI64VPROC glap_glGetQueryObjectui64v;
+#define glGetQueryObjectui64v glap_glGetQueryObjectui64v
+extern PFNGLUNIFORMBLOCKBINDINGPROC glap_glUniformBlockBinding;
+#define glUniformBlockBinding glap_glUniformBlockBinding
+extern PFNGLVERTEXATTRIBDIVISORPROC glap_glVertexAttribDivisor;
+#define glVertexAttribDivisor glap_glVertexAttribDivisor
+
+/**
+ * @brief Load the entry points above with `load`, after glad has loaded OpenGL 3.0.
+ * @returns False if any of them is missing, which means the context is older than OpenGL 3.3
+ */
+bool LoadGl33(GLADloadfunc load);
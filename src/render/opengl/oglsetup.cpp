@@ -7,6 +7,7 @@
 #include <app.hpp>
 #include <iostream>
 #include "opengl.hpp"
+#include "oglstate.hpp"
 
 #if _IMPL_WINDOW == _IMPL_WINDOW_GLFW
 #include <GLFW/glfw3.h>
@@ -18,6 +19,8 @@ static void load_opengl() {
             int version = gladLoadGL(glfwGetProcAddress);
             if (!version)
                 PLATFORM_ERROR("gladLoadGL failed");
+            if (!LoadGl33(glfwGetProcAddress))
+                PLATFORM_ERROR("OpenGL 3.3 is not supported");
             std::cout << "GL " << GLAD_VERSION_MAJOR(version) << '.' << GLAD_VERSION_MINOR(version);
             std::cout << std::endl;
         #else // Load with GLAD's built-in loader
@@ -38,6 +41,9 @@ void OglSetup() {
     // Enable alpha/transparency
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    // Nothing is known about the new context's state yet
+    OglState::Invalidate();
 }
 
 void OglCleanup() {}
\ No newline at end of file
@@ -1,7 +1,11 @@
 #include "oglshader.hpp"
+#include "oglstate.hpp"
 #include <array>
 #include <vector>
 #include <cstddef>
+#include <algorithm>
+#include <string>
+#include <cstring>
 #include <util/str.hpp>
 #include <util/defer.hpp>
 
@@ -74,6 +78,63 @@ bool OglProgram::AttachShader(const OglShader& shader) {
     return glGetError() == GL_NO_ERROR;
 }
 
+/** @return `true` if a uniform of `uniform_type` can be set from a value of `value_type` */
+static bool IsUniformCompatible(GLenum uniform_type, GLenum value_type) {
+    if (uniform_type == value_type)
+        return true;
+    // Bools and samplers are set from ints
+    if (value_type == GL_INT) {
+        switch (uniform_type) {
+        case GL_BOOL:
+        case GL_SAMPLER_2D:
+        case GL_SAMPLER_3D:
+        case GL_SAMPLER_CUBE:
+        case GL_SAMPLER_2D_ARRAY:
+            return true;
+        }
+    }
+    return false;
+}
+
+/** @return Size of one element of a uniform in the shadow copy, or `0` if it's of a type that isn't shadowed */
+static uint32_t GetUniformElementSize(GLenum type) {
+    switch (type) {
+    case GL_INT:
+    case GL_BOOL:
+    case GL_SAMPLER_2D:
+    case GL_SAMPLER_3D:
+    case GL_SAMPLER_CUBE:
+    case GL_SAMPLER_2D_ARRAY:
+    case GL_FLOAT:        return 4;
+    case GL_FLOAT_VEC2:   return sizeof(glm::vec2);
+    case GL_FLOAT_VEC3:   return sizeof(glm::vec3);
+    case GL_FLOAT_VEC4:   return sizeof(glm::vec4);
+    case GL_FLOAT_MAT3:   return sizeof(glm::mat3);
+    case GL_FLOAT_MAT4:   return sizeof(glm::mat4);
+    default:              return 0;
+    }
+}
+
+/** Send `count` elements of a uniform to the current program */
+static void UploadUniform(GLenum type, GLint location, GLsizei count, const void* data) {
+    OglState::CountUniformUpload();
+    switch (type) {
+    case GL_INT:
+    case GL_BOOL:
+    case GL_SAMPLER_2D:
+    case GL_SAMPLER_3D:
+    case GL_SAMPLER_CUBE:
+    case GL_SAMPLER_2D_ARRAY:
+        glUniform1iv(location, count, (const GLint*)data); break;
+    case GL_FLOAT:      glUniform1fv(location, count, (const GLfloat*)data); break;
+    case GL_FLOAT_VEC2: glUniform2fv(location, count, (const GLfloat*)data); break;
+    case GL_FLOAT_VEC3: glUniform3fv(location, count, (const GLfloat*)data); break;
+    case GL_FLOAT_VEC4: glUniform4fv(location, count, (const GLfloat*)data); break;
+    case GL_FLOAT_MAT3: glUniformMatrix3fv(location, count, GL_FALSE, (const GLfloat*)data); break;
+    case GL_FLOAT_MAT4: glUniformMatrix4fv(location, count, GL_FALSE, (const GLfloat*)data); break;
+    }
+}
+
 bool OglProgram::Link() {
     while (glGetError() != GL_NO_ERROR) {} // Clear existing errors
 
@@ -96,91 +157,252 @@ bool OglProgram::Link() {
         return false;
     }
 
-    // Dump all the uniforms into a map.
+    // Dump all the uniforms and attributes into maps.
     // Then we can look them up without weird stutters (on Windows, at least).
+    m_uniforms.clear();
+    m_uniform_map.clear();
+    m_element_map.clear();
+    m_attribs.clear();
+    m_attrib_map.clear();
+    m_uniform_blocks.clear();
+    m_uniform_values.clear();
+    m_uniform_data.clear();
+    m_location_slots.clear();
+    m_dirty_uniforms.clear();
+
+    GLint max_name_length = 0;
+    glGetProgramiv(m_gl_program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_name_length);
+    std::vector<GLchar> name(std::max(max_name_length, 1));
 
     GLint num_uniforms;
     glGetProgramiv(m_gl_program, GL_ACTIVE_UNIFORMS, &num_uniforms);
     for (GLint i = 0; i < num_uniforms; ++i) {
-        std::array<GLchar, 64> name;
-        GLsizei name_len;
+        GLsizei name_len = 0;
         GLint uniform_size;
         GLenum type;
         glGetActiveUniform(m_gl_program, (GLuint)i, name.size(), &name_len, &uniform_size, &type, name.data());
 
-        GLint location;
-        location = glGetUniformLocation(m_gl_program, name.data());
+        GLint block_index = -1;
+        const GLuint index = (GLuint)i;
+        glGetActiveUniformsiv(m_gl_program, 1, &index, GL_UNIFORM_BLOCK_INDEX, &block_index);
+
+        // Arrays are reported by their first element
+        std::string_view name_view{name.data(), (size_t)name_len};
+        if (name_view.ends_with("[0]"))
+            name_view.remove_suffix(3);
+        OglUniform uniform{std::string(name_view), -1, type, uniform_size, block_index};
+
+        // Uniforms in blocks are set through their buffer, so they have no location
+        if (block_index == -1) {
+            uniform.location = glGetUniformLocation(m_gl_program, name.data());
+            for (GLint element = 1; element < uniform_size; ++element) {
+                std::string element_name = uniform.name + "[" + std::to_string(element) + "]";
+                m_element_map.emplace(element_name, glGetUniformLocation(m_gl_program, element_name.c_str()));
+            }
+        }
+        m_uniform_map.emplace(uniform.name, m_uniforms.size());
+        m_uniforms.push_back(std::move(uniform));
+    }
+    CreateUniformShadow();
+
+    max_name_length = 0;
+    glGetProgramiv(m_gl_program, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &max_name_length);
+    name.resize(std::max(max_name_length, 1));
+
+    GLint num_blocks;
+    glGetProgramiv(m_gl_program, GL_ACTIVE_UNIFORM_BLOCKS, &num_blocks);
+    for (GLint i = 0; i < num_blocks; ++i) {
+        GLsizei name_len = 0;
+        glGetActiveUniformBlockName(m_gl_program, (GLuint)i, name.size(), &name_len, name.data());
+        GLint data_size = 0;
+        glGetActiveUniformBlockiv(m_gl_program, (GLuint)i, GL_UNIFORM_BLOCK_DATA_SIZE, &data_size);
+        m_uniform_blocks.push_back(OglUniformBlock{std::string(name.data(), (size_t)name_len), (GLuint)i, data_size});
+    }
+
+    max_name_length = 0;
+    glGetProgramiv(m_gl_program, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &max_name_length);
+    name.resize(std::max(max_name_length, 1));
 
+    GLint num_attribs;
+    glGetProgramiv(m_gl_program, GL_ACTIVE_ATTRIBUTES, &num_attribs);
+    for (GLint i = 0; i < num_attribs; ++i) {
+        GLsizei name_len = 0;
+        GLint attrib_size;
+        GLenum type;
+        glGetActiveAttrib(m_gl_program, (GLuint)i, name.size(), &name_len, &attrib_size, &type, name.data());
+
+        GLint location = glGetAttribLocation(m_gl_program, name.data());
         std::string_view name_view{name.data(), (size_t)name_len};
-        m_uniform_map.emplace(std::pair<std::string, GLuint>{name_view, (GLuint)location});
+        m_attrib_map.emplace(std::string(name_view), m_attribs.size());
+        m_attribs.push_back(OglAttrib{std::string(name_view), location, type, attrib_size});
     }
     
     return true;
 }
 
-GLint OglProgram::GetUniformLocation(std::string_view name) const {
+const OglUniform* OglProgram::FindUniform(std::string_view name) const {
     auto it = m_uniform_map.find(name);
+    if (it == m_uniform_map.end() && name.ends_with("[0]"))
+        it = m_uniform_map.find(name.substr(0, name.size() - 3));
     if (it == m_uniform_map.end())
+        return nullptr;
+    return &m_uniforms[it->second];
+}
+const OglAttrib* OglProgram::FindAttrib(std::string_view name) const {
+    auto it = m_attrib_map.find(name);
+    if (it == m_attrib_map.end())
+        return nullptr;
+    return &m_attribs[it->second];
+}
+
+const OglUniformBlock* OglProgram::FindUniformBlock(std::string_view name) const {
+    for (const OglUniformBlock& block : m_uniform_blocks) {
+        if (block.name == name)
+            return &block;
+    }
+    return nullptr;
+}
+
+bool OglProgram::BindUniformBlock(std::string_view name, GLuint binding) {
+    const OglUniformBlock* block = FindUniformBlock(name);
+    if (block == nullptr)
+        return false;
+    glUniformBlockBinding(m_gl_program, block->index, binding);
+    return true;
+}
+
+GLint OglProgram::GetUniformLocation(std::string_view name) const {
+    if (const OglUniform* uniform = FindUniform(name))
+        return uniform->location;
+    auto it = m_element_map.find(name);
+    if (it == m_element_map.end())
         return -1;
     return it->second;
 }
 GLint OglProgram::GetAttribLocation(std::string_view name) const {
-    return glGetAttribLocation(m_gl_program, name.data());
-}
-
-void OglProgram::SetInt(GLint param, int val) {
-    if (param == -1) return;
-    GLint oldProgram = 0;
-    glGetIntegerv(GL_CURRENT_PROGRAM, &oldProgram);
-    glUseProgram(GlHandle());
-    glUniform1i((GLint)param, val);
-    glUseProgram(oldProgram);
-}
-void OglProgram::SetFloat(GLint param, float val) {
-    if (param == -1) return;
-    GLint oldProgram = 0;
-    glGetIntegerv(GL_CURRENT_PROGRAM, &oldProgram);
-    glUseProgram(GlHandle());
-    glUniform1f((GLint)param, val);
-    glUseProgram(oldProgram);
-}
-void OglProgram::SetVec2(GLint param, const glm::vec2& val) {
-    if (param == -1) return;
-    GLint oldProgram = 0;
-    glGetIntegerv(GL_CURRENT_PROGRAM, &oldProgram);
-    glUseProgram(GlHandle());
-    glUniform2f((GLint)param, val[0], val[1]);
-    glUseProgram(oldProgram);
-}
-void OglProgram::SetVec3(GLint param, const glm::vec3& val) {
-    if (param == -1) return;
-    GLint oldProgram = 0;
-    glGetIntegerv(GL_CURRENT_PROGRAM, &oldProgram);
-    glUseProgram(GlHandle());
-    glUniform3f((GLint)param, val[0], val[1], val[2]);
-    glUseProgram(oldProgram);
-}
-void OglProgram::SetVec4(GLint param, const glm::vec4& val) {
-    if (param == -1) return;
-    GLint oldProgram = 0;
-    glGetIntegerv(GL_CURRENT_PROGRAM, &oldProgram);
-    glUseProgram(GlHandle());
-    glUniform4f((GLint)param, val[0], val[1], val[2], val[3]);
-    glUseProgram(oldProgram);
-}
-void OglProgram::SetMat3(GLint param, const glm::mat3& val) {
-    if (param == -1) return;
-    GLint oldProgram = 0;
-    glGetIntegerv(GL_CURRENT_PROGRAM, &oldProgram);
-    glUseProgram(GlHandle());
-    glUniformMatrix3fv((GLint)param, 1, GL_FALSE, &val[0][0]);
-    glUseProgram(oldProgram);
-}
-void OglProgram::SetMat4(GLint param, const glm::mat4& val) {
-    if (param == -1) return;
-    GLint oldProgram = 0;
-    glGetIntegerv(GL_CURRENT_PROGRAM, &oldProgram);
-    glUseProgram(GlHandle());
-    glUniformMatrix4fv((GLint)param, 1, GL_FALSE, &val[0][0]);
-    glUseProgram(oldProgram);
-}
\ No newline at end of file
+    const OglAttrib* attrib = FindAttrib(name);
+    return attrib ? attrib->location : -1;
+}
+
+GLint OglProgram::GetUniformLocationFor(std::string_view name, GLenum type) const {
+    GLint location = GetUniformLocation(name);
+    if (location == -1)
+        return -1;
+
+    // Array elements share the type of their array
+    const OglUniform* uniform = FindUniform(name);
+    if (uniform == nullptr)
+        uniform = FindUniform(name.substr(0, name.find('[')));
+    if (uniform == nullptr || IsUniformCompatible(uniform->type, type))
+        return location;
+
+    if (!uniform->warned) {
+        uniform->warned = true;
+        PLATFORM_WARNING("Uniform \"" + std::string(name) + "\" doesn't match the type of its value");
+    }
+    return -1;
+}
+
+void OglProgram::CreateUniformShadow() {
+    m_uniform_values.resize(m_uniforms.size());
+    std::vector<GLint> locations;
+    for (size_t i = 0; i < m_uniforms.size(); ++i) {
+        const OglUniform& uniform = m_uniforms[i];
+        const uint32_t element_size = GetUniformElementSize(uniform.type);
+        if (uniform.location == -1 || element_size == 0)
+            continue;
+
+        locations.assign(1, uniform.location);
+        for (GLint element = 1; element < uniform.size; ++element)
+            locations.push_back(GetUniformLocation(uniform.name + "[" + std::to_string(element) + "]"));
+        // Other elements would be set immediately, then overwritten by a stale copy
+        if (*std::max_element(locations.begin(), locations.end()) > MAX_SHADOWED_LOCATION)
+            continue;
+
+        m_uniform_values[i].offset = (uint32_t)m_uniform_data.size();
+        m_uniform_data.resize(m_uniform_data.size() + element_size * uniform.size);
+        for (GLint element = 0; element < uniform.size; ++element) {
+            const GLint location = locations[element];
+            if (location == -1)
+                continue;
+            if ((size_t)location >= m_location_slots.size())
+                m_location_slots.resize(location + 1);
+            m_location_slots[location] = { (int32_t)i, element };
+
+            // Start from the linked values, which may come from initializers in the shader
+            void* dst = m_uniform_data.data() + m_uniform_values[i].offset + element_size * element;
+            if (IsUniformCompatible(uniform.type, GL_INT))
+                glGetUniformiv(m_gl_program, location, (GLint*)dst);
+            else
+                glGetUniformfv(m_gl_program, location, (GLfloat*)dst);
+        }
+    }
+}
+
+template <class T>
+void OglProgram::SetUniform(GLint location, const T* values, GLsizei count) {
+    if (location < 0)
+        return;
+    if ((size_t)location >= m_location_slots.size() || m_location_slots[location].uniform == -1) {
+        // Not shadowed, so send it right away
+        GLuint old_program = BeginUniform();
+        UploadUniform(GlUniformType<T>(), location, count, values);
+        EndUniform(old_program);
+        return;
+    }
+
+    const LocationSlot& slot = m_location_slots[location];
+    const OglUniform& uniform = m_uniforms[slot.uniform];
+    // GL would ignore a value of the wrong type
+    if (!IsUniformCompatible(uniform.type, GlUniformType<T>()))
+        return;
+
+    UniformValue& value = m_uniform_values[slot.uniform];
+    const size_t size = sizeof(T) * std::min<GLsizei>(count, uniform.size - slot.element);
+    uint8_t* dst = m_uniform_data.data() + value.offset + sizeof(T) * slot.element;
+    if (memcmp(dst, values, size) == 0) {
+        OglState::CountSkipped();
+        return;
+    }
+    memcpy(dst, values, size);
+    if (!value.dirty) {
+        value.dirty = true;
+        m_dirty_uniforms.push_back(slot.uniform);
+    }
+}
+
+void OglProgram::Use() {
+    OglState::UseProgram(GlHandle());
+    for (uint32_t index : m_dirty_uniforms) {
+        const OglUniform& uniform = m_uniforms[index];
+        UniformValue& value = m_uniform_values[index];
+        value.dirty = false;
+        UploadUniform(uniform.type, uniform.location, uniform.size, m_uniform_data.data() + value.offset);
+    }
+    m_dirty_uniforms.clear();
+}
+
+GLuint OglProgram::BeginUniform() const {
+    GLuint old_program = OglState::GetProgram();
+    if (old_program == OglState::UNKNOWN_PROGRAM) {
+        GLint current = 0;
+        glGetIntegerv(GL_CURRENT_PROGRAM, &current);
+        old_program = (GLuint)current;
+    }
+    if (old_program != (GLuint)GlHandle())
+        glUseProgram(GlHandle());
+    return old_program;
+}
+void OglProgram::EndUniform(GLuint old_program) const {
+    if (old_program != (GLuint)GlHandle())
+        glUseProgram(old_program);
+}
+
+void OglProgram::SetInt(GLint param, int val) { SetUniform(param, &val, 1); }
+void OglProgram::SetIntArray(GLint param, const int* vals, GLsizei count) { SetUniform(param, vals, count); }
+void OglProgram::SetFloat(GLint param, float val) { SetUniform(param, &val, 1); }
+void OglProgram::SetVec2(GLint param, const glm::vec2& val) { SetUniform(param, &val, 1); }
+void OglProgram::SetVec3(GLint param, const glm::vec3& val) { SetUniform(param, &val, 1); }
+void OglProgram::SetVec4(GLint param, const glm::vec4& val) { SetUniform(param, &val, 1); }
+void OglProgram::SetMat3(GLint param, const glm::mat3& val) { SetUniform(param, &val, 1); }
+void OglProgram::SetMat4(GLint param, const glm::mat4& val) { SetUniform(param, &val, 1); }
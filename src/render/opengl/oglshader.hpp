@@ -5,6 +5,8 @@
 #include <string>
 #include <string_view>
 #include <unordered_map>
+#include <vector>
+#include <type_traits>
 #include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
 #include <glm/vec4.hpp>
@@ -38,6 +40,53 @@ private:
 
 class OglShader;
 
+/// @brief A uniform of a linked program, as reported by `glGetActiveUniform`
+struct OglUniform {
+    /// @brief Name without any trailing `[0]`
+    std::string name;
+    /// @brief Location of the first element, or `-1` if it's in a uniform block
+    GLint location;
+    /// @brief Such as `GL_FLOAT_VEC2`, or `GL_SAMPLER_2D`
+    GLenum type;
+    /// @brief Number of array elements, or `1` if it isn't an array
+    GLint size;
+    /// @brief Index of its uniform block, or `-1` if it isn't in one
+    GLint block_index;
+    /// @brief Set after warning about a value of the wrong type, so each uniform only warns once
+    mutable bool warned = false;
+};
+
+/// @brief A uniform block of a linked program
+struct OglUniformBlock {
+    std::string name;
+    /// @brief Index for `glUniformBlockBinding`
+    GLuint index;
+    /// @brief Minimum size of a buffer range bound to the block, in bytes
+    GLint data_size;
+};
+
+/// @brief A vertex attribute of a linked program, as reported by `glGetActiveAttrib`
+struct OglAttrib {
+    std::string name;
+    GLint location;
+    /// @brief Such as `GL_FLOAT_VEC4`
+    GLenum type;
+    GLint size;
+};
+
+/** @return The GL type of a uniform that is set from a `T` */
+template <class T>
+constexpr GLenum GlUniformType() {
+    if constexpr (std::is_same_v<T, int>)              return GL_INT;
+    else if constexpr (std::is_same_v<T, float>)       return GL_FLOAT;
+    else if constexpr (std::is_same_v<T, glm::vec2>)   return GL_FLOAT_VEC2;
+    else if constexpr (std::is_same_v<T, glm::vec3>)   return GL_FLOAT_VEC3;
+    else if constexpr (std::is_same_v<T, glm::vec4>)   return GL_FLOAT_VEC4;
+    else if constexpr (std::is_same_v<T, glm::mat3x3>) return GL_FLOAT_MAT3;
+    else if constexpr (std::is_same_v<T, glm::mat4x4>) return GL_FLOAT_MAT4;
+    else static_assert(!std::is_same_v<T, T>, "Unsupported uniform type");
+}
+
 class OglProgram
 {
 public:
@@ -47,11 +96,43 @@ public:
     bool AttachShader(const OglShader& shader);
     bool Link();
 
+    /**
+     * @param name Name of a uniform, or of one array element such as `"in_textures[2]"`
+     * @return Location of the uniform, or `-1` if it isn't active
+     */
     GLint GetUniformLocation(std::string_view name) const;
     GLint GetAttribLocation(std::string_view name) const;
+    /** @return Reflection of an active uniform or its array, or `nullptr`. Array elements aren't listed apart. */
+    const OglUniform* FindUniform(std::string_view name) const;
+    const OglAttrib* FindAttrib(std::string_view name) const;
+    const std::vector<OglUniform>& GetUniforms() const { return m_uniforms; }
+    const std::vector<OglAttrib>& GetAttribs() const { return m_attribs; }
+    const OglUniformBlock* FindUniformBlock(std::string_view name) const;
+    const std::vector<OglUniformBlock>& GetUniformBlocks() const { return m_uniform_blocks; }
+    /**
+     * @brief Read a uniform block from the buffer range bound at `binding`
+     * @return `false` if the block isn't active
+     */
+    bool BindUniformBlock(std::string_view name, GLuint binding);
+
+    /**
+     * @brief Get the location of a uniform that is set from a `T`.
+     * Warns once for each uniform of another type, since GL would ignore the value.
+     * @return Location of the uniform, or `-1` if it isn't active or has another type
+     */
+    template <class T>
+    GLint GetUniformLocationFor(std::string_view name) const { return GetUniformLocationFor(name, GlUniformType<T>()); }
+    GLint GetUniformLocationFor(std::string_view name, GLenum type) const;
     GLint GlHandle() const { return m_gl_program; }
 
+    /** Bind the program, and send any uniform values that changed since it was last bound */
+    void Use();
+
+    // Uniform values are kept in a shadow copy, which starts with the values read back at link time.
+    // Setters only write the copy. Changed values are sent all at once by the next call to @ref Use.
     void SetInt(GLint uniform, int val);
+    /** Set `count` consecutive elements of an array, starting with the element at `uniform` */
+    void SetIntArray(GLint uniform, const int* vals, GLsizei count);
     void SetFloat(GLint uniform, float val);
     void SetVec2(GLint uniform, const glm::vec2& val);
     void SetVec3(GLint uniform, const glm::vec3& val);
@@ -75,6 +156,48 @@ private:
 
     OglProgram(const OglProgram&) = delete;
 
+    /// @brief Where the shadow copy of an active uniform is kept
+    struct UniformValue {
+        /// @brief Byte offset into @ref m_uniform_data
+        uint32_t offset;
+        /// @brief Listed in @ref m_dirty_uniforms
+        bool dirty = false;
+    };
+    /// @brief The uniform and array element at a location
+    struct LocationSlot {
+        /// @brief Index into @ref m_uniforms, or `-1` if no shadowed uniform is at this location
+        int32_t uniform = -1;
+        int32_t element = 0;
+    };
+    /// @brief Locations past this are set immediately, instead of wasting a huge table on them
+    static constexpr GLint MAX_SHADOWED_LOCATION = 4096;
+
+    /** Lay out the shadow copy of each active uniform, after reflection */
+    void CreateUniformShadow();
+    /** Write `count` values starting at `location` into the shadow copy, and mark the uniform dirty if they changed */
+    template <class T>
+    void SetUniform(GLint location, const T* values, GLsizei count);
+
+    /** Make this the current program for setting a uniform. Skips the switch if it's already current. @return The previous program */
+    GLuint BeginUniform() const;
+    /** Restore the program returned by @ref BeginUniform */
+    void EndUniform(GLuint old_program) const;
+
     GLint m_gl_program;
-    std::unordered_map<std::string, GLuint, StringHash, std::equal_to<>> m_uniform_map;
+    std::vector<OglUniform> m_uniforms;
+    std::vector<OglAttrib> m_attribs;
+    std::vector<OglUniformBlock> m_uniform_blocks;
+    /// @brief Index into @ref m_uniforms by name
+    std::unordered_map<std::string, size_t, StringHash, std::equal_to<>> m_uniform_map;
+    /// @brief Location of each array element other than the first, which may not be consecutive
+    std::unordered_map<std::string, GLint, StringHash, std::equal_to<>> m_element_map;
+    /// @brief One per item of @ref m_uniforms
+    std::vector<UniformValue> m_uniform_values;
+    std::vector<uint8_t> m_uniform_data;
+    /// @brief Indexed by location
+    std::vector<LocationSlot> m_location_slots;
+    /// @brief Indices of uniforms whose values changed since the last @ref Use
+    std::vector<uint32_t> m_dirty_uniforms;
+    /// @brief Index into @ref m_attribs by name
+    std::unordered_map<std::string, size_t, StringHash, std::equal_to<>> m_attrib_map;
 };
\ No newline at end of file
@@ -0,0 +1,112 @@
+#include "oglstate.hpp"
+#include <array>
+
+namespace OglState {
+
+static constexpr GLuint UNKNOWN_OBJECT = UINT32_MAX;
+
+static GLuint m_program = UNKNOWN_PROGRAM;
+static GLuint m_active_unit = UNKNOWN_OBJECT;
+static std::array<GLuint, MAX_TRACKED_UNITS> m_textures;
+static std::array<GLenum, 4> m_blend_func;
+/// @brief `0` if disabled, `1` if enabled, or `-1` if unknown
+static int m_scissor_enabled = -1;
+/// @brief An unknown rect has a negative size
+static std::array<GLint, 4> m_scissor;
+static GLuint m_vertex_array = UNKNOWN_OBJECT;
+static GLuint m_array_buffer = UNKNOWN_OBJECT;
+/// @brief Buffer, offset and size bound to each uniform buffer binding point
+static std::array<std::array<GLintptr, 3>, MAX_TRACKED_UNIFORM_BUFFERS> m_uniform_buffers;
+static Stats m_stats;
+
+/** @return `true` if `cached` was changed to `value`, and counts the result */
+template <class T>
+static bool Update(T& cached, const T& value) {
+    if (cached == value) {
+        ++m_stats.skipped;
+        return false;
+    }
+    cached = value;
+    ++m_stats.issued;
+    return true;
+}
+
+void Invalidate() {
+    m_program = UNKNOWN_PROGRAM;
+    m_active_unit = UNKNOWN_OBJECT;
+    m_textures.fill(UNKNOWN_OBJECT);
+    m_blend_func.fill(UNKNOWN_OBJECT);
+    m_scissor_enabled = -1;
+    m_scissor.fill(-1);
+    m_vertex_array = UNKNOWN_OBJECT;
+    m_array_buffer = UNKNOWN_OBJECT;
+    for (auto& binding : m_uniform_buffers)
+        binding = { -1, -1, -1 };
+}
+
+void UseProgram(GLuint program) {
+    if (Update(m_program, program)) {
+        glUseProgram(program);
+        ++m_stats.program_switches;
+    }
+}
+
+GLuint GetProgram() { return m_program; }
+
+void BindTexture(GLuint unit, GLuint texture) {
+    if (unit < MAX_TRACKED_UNITS && !Update(m_textures[unit], texture))
+        return;
+    if (m_active_unit != unit) {
+        m_active_unit = unit;
+        glActiveTexture(GL_TEXTURE0 + unit);
+    }
+    glBindTexture(GL_TEXTURE_2D, texture);
+    ++m_stats.texture_binds;
+}
+
+void BlendFunc(GLenum src_rgb, GLenum dst_rgb, GLenum src_alpha, GLenum dst_alpha) {
+    std::array<GLenum, 4> blend_func = { src_rgb, dst_rgb, src_alpha, dst_alpha };
+    if (Update(m_blend_func, blend_func))
+        glBlendFuncSeparate(src_rgb, dst_rgb, src_alpha, dst_alpha);
+}
+
+void EnableScissor(bool enable) {
+    if (!Update(m_scissor_enabled, (int)enable))
+        return;
+    ++m_stats.scissor_changes;
+    if (enable)
+        glEnable(GL_SCISSOR_TEST);
+    else
+        glDisable(GL_SCISSOR_TEST);
+}
+
+void Scissor(GLint x, GLint y, GLsizei width, GLsizei height) {
+    std::array<GLint, 4> scissor = { x, y, width, height };
+    if (Update(m_scissor, scissor)) {
+        glScissor(x, y, width, height);
+        ++m_stats.scissor_changes;
+    }
+}
+
+void BindVertexArray(GLuint vertex_array) {
+    if (Update(m_vertex_array, vertex_array))
+        glBindVertexArray(vertex_array);
+}
+
+void BindArrayBuffer(GLuint buffer) {
+    if (Update(m_array_buffer, buffer))
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+}
+
+void BindUniformBuffer(GLuint binding, GLuint buffer, GLintptr offset, GLsizeiptr size) {
+    if (binding < MAX_TRACKED_UNIFORM_BUFFERS && !Update(m_uniform_buffers[binding], { (GLintptr)buffer, offset, size }))
+        return;
+    glBindBufferRange(GL_UNIFORM_BUFFER, binding, buffer, offset, size);
+}
+
+void CountSkipped(uint32_t count) { m_stats.skipped += count; }
+void CountUniformUpload() { ++m_stats.uniform_uploads; }
+const Stats& GetStats() { return m_stats; }
+void ResetStats() { m_stats = {}; }
+
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include "opengl.hpp"
+#include <cstdint>
+
+/**
+ * @brief Shadowed copy of commonly changed GL state, so redundant changes are never sent to the driver.
+ * The cache only knows about changes made through it. Call @ref Invalidate before use if other code may have changed the state,
+ * and after use if other code will change it (such as DearImGui's renderer).
+ */
+namespace OglState {
+    /// @brief Returned by @ref GetProgram when the current program is unknown
+    static constexpr GLuint UNKNOWN_PROGRAM = UINT32_MAX;
+    /// @brief Number of texture units that are tracked. Other units are always bound.
+    static constexpr GLuint MAX_TRACKED_UNITS = 16;
+    /// @brief Number of uniform buffer binding points that are tracked. Other points are always bound.
+    static constexpr GLuint MAX_TRACKED_UNIFORM_BUFFERS = 4;
+
+    struct Stats {
+        /// @brief State changes that were sent to GL
+        uint32_t issued = 0;
+        /// @brief State changes that were skipped, since the state was already set
+        uint32_t skipped = 0;
+        /// @brief Issued changes of the current program
+        uint32_t program_switches = 0;
+        /// @brief Issued texture bindings
+        uint32_t texture_binds = 0;
+        /// @brief Issued changes of the scissor rect or scissor test
+        uint32_t scissor_changes = 0;
+        /// @brief Uniforms sent to GL, which aren't cached here and aren't counted as state changes
+        uint32_t uniform_uploads = 0;
+    };
+
+    /** Forget all cached state. The next change of each state is always sent. @ref OglSetup calls this for a new context. */
+    void Invalidate();
+
+    void UseProgram(GLuint program);
+    /// @return The current program, or @ref UNKNOWN_PROGRAM
+    GLuint GetProgram();
+    /** Bind a 2D texture to a texture unit. The active unit is changed only when the binding is. */
+    void BindTexture(GLuint unit, GLuint texture);
+    /** Set the blend factors, as if by `glBlendFuncSeparate` */
+    void BlendFunc(GLenum src_rgb, GLenum dst_rgb, GLenum src_alpha, GLenum dst_alpha);
+    inline void BlendFunc(GLenum src, GLenum dst) { BlendFunc(src, dst, src, dst); }
+    void EnableScissor(bool enable);
+    void Scissor(GLint x, GLint y, GLsizei width, GLsizei height);
+    void BindVertexArray(GLuint vertex_array);
+    /** Bind a buffer to `GL_ARRAY_BUFFER`. The element buffer is part of the vertex array, so it isn't tracked here. */
+    void BindArrayBuffer(GLuint buffer);
+    /** Bind a range of a buffer to a uniform buffer binding point, as if by `glBindBufferRange` */
+    void BindUniformBuffer(GLuint binding, GLuint buffer, GLintptr offset, GLsizeiptr size);
+
+    /** Count a state change that the caller skipped with its own cache, such as vertex attribute pointers */
+    void CountSkipped(uint32_t count = 1);
+    /** Count a uniform that was sent to GL, as by `glUniform*` */
+    void CountUniformUpload();
+    const Stats& GetStats();
+    void ResetStats();
+}
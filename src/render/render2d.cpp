@@ -1,19 +1,28 @@
 #include "render2d.hpp"
+#include "render2d_backend.hpp"
 #include "texture.hpp"
 #include "opengl/oglshader.hpp"
 #include "opengl/oglframebuffer.hpp"
+#include "opengl/oglstate.hpp"
 #include <platform.hpp>
+#include <profiler.hpp>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <util/defer.hpp>
+#include <span>
+#include <string>
+#include <array>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cstring>
 
 // Compile these files together
 #include "render2d_draw.cpp"
 
 static const char* VERT_SHADER_SRC =
 IMPL_GLSL_VERSION_HEADER
-"uniform mat4 pixel_to_normalized;"
-"uniform vec2 texel_to_normalized;"
+RENDER2D_FRAME_CONSTANTS_GLSL
 "in vec2 in_pos;"
 "in vec2 in_uv;"
 "in vec4 in_color;"
@@ -22,10 +31,46 @@ IMPL_GLSL_VERSION_HEADER
 
 "void main() {"
 "   gl_Position = pixel_to_normalized * vec4(in_pos, 0.0, 1.0);"
-"   frag_uv = texel_to_normalized * in_uv;"
+"   frag_uv = in_uv;"
 "   frag_color = in_color;"
 "}";
 
+// Expands each instance of `Quad` from a shared unit quad
+static const char* QUAD_VERT_SHADER_SRC =
+IMPL_GLSL_VERSION_HEADER
+RENDER2D_FRAME_CONSTANTS_GLSL
+"in vec2 in_corner;"
+"in vec4 in_rect;"
+"in vec4 in_uv_rect;"
+"in vec4 in_color;"
+"in float in_slot;"
+"in float in_shape;"
+"in vec3 in_shape_params;"
+"out vec2 frag_uv;"
+"out vec4 frag_color;"
+"flat out int frag_slot;"
+"flat out int frag_shape;"
+// Radius, border, and softness in pixels
+"flat out highp vec3 frag_shape_params;"
+// Half the size of the shape, which is inset from the quad by its softness
+"flat out highp vec2 frag_shape_extent;"
+// Position relative to the quad's center, in pixels
+"out highp vec2 frag_shape_pos;"
+
+"void main() {"
+"   vec2 pos = in_rect.xy + in_corner * in_rect.zw;"
+"   gl_Position = pixel_to_normalized * vec4(pos, 0.0, 1.0);"
+"   frag_uv = mix(in_uv_rect.xy, in_uv_rect.zw, in_corner);"
+"   frag_color = in_color;"
+"   frag_slot = int(in_slot);"
+"   frag_shape = int(in_shape);"
+// Divide by SHAPE_UNITS_PER_PIXEL
+"   frag_shape_params = in_shape_params / 16.0;"
+"   vec2 size = abs(in_rect.zw);"
+"   frag_shape_extent = max(size * 0.5 - frag_shape_params.z, 0.0);"
+"   frag_shape_pos = (in_corner - 0.5) * size;"
+"}";
+
 static const char* FRAG_SHADER_SRC =
 IMPL_GLSL_VERSION_HEADER
 "precision mediump float;"
@@ -41,7 +86,84 @@ IMPL_GLSL_VERSION_HEADER
 
 namespace Render2d {
 
-void BindShaderParams(const DrawList& drawlist, const DrawCall& call, OglProgramPtr program);
+static_assert(SHAPE_UNITS_PER_PIXEL == 16.f, "Update QUAD_VERT_SHADER_SRC");
+
+/**
+ * @brief Source of the default quad fragment shader, which samples the texture in the quad's slot.
+ * GLSL ES 3.0 can't index samplers dynamically, so each slot gets its own branch.
+ * Derivatives are taken outside the branches, where they're still well-defined.
+ * The quad's @ref QuadShape is evaluated as a signed distance in pixels, which gives it a one pixel anti-aliased edge.
+ */
+static std::string GetQuadFragShaderSource() {
+    std::string src =
+    IMPL_GLSL_VERSION_HEADER
+    "precision mediump float;"
+    "in vec2 frag_uv;"
+    "in vec4 frag_color;"
+    "flat in int frag_slot;"
+    "flat in int frag_shape;"
+    "flat in highp vec3 frag_shape_params;"
+    "flat in highp vec2 frag_shape_extent;"
+    "in highp vec2 frag_shape_pos;"
+    "out vec4 final_frag_color;"
+    "uniform sampler2D in_textures[" + std::to_string(MAX_TEXTURE_SLOTS) + "];"
+    RENDER2D_BATCH_CONSTANTS_GLSL
+
+    "float ShapeCoverage() {"
+    "   if (frag_shape == " + std::to_string((int)QuadShape::RECT) + ")"
+    "       return 1.0;"
+    "   highp vec2 p = frag_shape_pos;"
+    "   highp vec2 extent = frag_shape_extent;"
+    "   highp float dist;"
+    "   if (frag_shape == " + std::to_string((int)QuadShape::ROUNDED_RECT) + ") {"
+    "       highp float radius = min(frag_shape_params.x, min(extent.x, extent.y));"
+    "       highp vec2 q = abs(p) - extent + radius;"
+    "       dist = length(max(q, 0.0)) + min(max(q.x, q.y), 0.0) - radius;"
+    "   } else {"
+    // An approximate distance, which is exact for circles
+    "       extent = max(extent, 1e-3);"
+    "       highp float k0 = length(p / extent);"
+    "       highp float k1 = length(p / (extent * extent));"
+    "       dist = k1 > 0.0 ? k0 * (k0 - 1.0) / k1 : -min(extent.x, extent.y);"
+    "   }"
+    "   highp float border = frag_shape_params.y;"
+    "   if (border > 0.0)"
+    "       dist = abs(dist + border * 0.5) - border * 0.5;"
+    "   highp float softness = frag_shape_params.z;"
+    "   if (softness > 0.0)"
+    "       return 1.0 - smoothstep(-softness, softness, dist);"
+    "   return clamp(0.5 - dist, 0.0, 1.0);"
+    "}"
+
+    "void main() {"
+    "   vec2 uv_dx = dFdx(frag_uv);"
+    "   vec2 uv_dy = dFdy(frag_uv);"
+    "   vec4 texel;";
+    for (uint32_t slot = 0; slot < MAX_TEXTURE_SLOTS; ++slot) {
+        std::string index = std::to_string(slot);
+        if (slot > 0)
+            src += " else ";
+        if (slot + 1 < MAX_TEXTURE_SLOTS)
+            src += "if (frag_slot == " + index + ") ";
+        src += "texel = textureGrad(in_textures[" + index + "], frag_uv, uv_dx, uv_dy);";
+    }
+    src +=
+    "   final_frag_color = texel * frag_color;"
+    "   float coverage = ShapeCoverage();"
+    "   final_frag_color.a *= coverage;"
+    "   if (premultiplied)"
+    "       final_frag_color.rgb *= coverage;"
+    "}";
+    return src;
+}
+
+static void BindShaderParams(const DrawList& drawlist, const DrawCall& call, OglProgram* program);
+/** @return The texture of a handle in the current draw list, or the default texture */
+static Texture* ResolveTexture(ResourceHandle texture);
+static void BindAttribs(std::span<const VertexAttrib> layout, const GLint* locations, GLsizei stride, uintptr_t base, GLuint divisor);
+
+/// @brief Corners of the unit quad, in triangle strip order
+static constexpr float UNIT_QUAD_CORNERS[] = { 0,0, 1,0, 0,1, 1,1 };
 
 OglShaderPtr GetDefaultVertShader() {
     static OglShaderPtr obj = OglShader::Compile(ShaderType::VERTEX, VERT_SHADER_SRC);
@@ -49,6 +171,18 @@ OglShaderPtr GetDefaultVertShader() {
         PLATFORM_ERROR("Failed to compile default vertex shader");
     return obj;
 }
+OglShaderPtr GetDefaultQuadVertShader() {
+    static OglShaderPtr obj = OglShader::Compile(ShaderType::VERTEX, QUAD_VERT_SHADER_SRC);
+    if (obj == nullptr)
+        PLATFORM_ERROR("Failed to compile default quad vertex shader");
+    return obj;
+}
+OglShaderPtr GetDefaultQuadFragShader() {
+    static OglShaderPtr obj = OglShader::Compile(ShaderType::FRAGMENT, GetQuadFragShaderSource());
+    if (obj == nullptr)
+        PLATFORM_ERROR("Failed to compile default quad fragment shader");
+    return obj;
+}
 OglShaderPtr GetDefaultFragShader() {
     static OglShaderPtr obj = OglShader::Compile(ShaderType::FRAGMENT, FRAG_SHADER_SRC);
     if (obj == nullptr)
@@ -70,9 +204,29 @@ OglProgramPtr GetDefaultProgram() {
     }
     return program;
 }
+OglProgramPtr GetDefaultQuadProgram() {
+    static OglProgramPtr program;
+    if (program == nullptr) {
+        OglProgramPtr new_program = std::make_shared<OglProgram>();
+        if (!new_program->AttachShader(*GetDefaultQuadVertShader())
+            || !new_program->AttachShader(*GetDefaultQuadFragShader())
+            || !new_program->Link()
+        ) {
+            PLATFORM_ERROR("Failed to link default quad shaders");
+            return nullptr;
+        }
+        // Each slot samples from the texture unit of the same index
+        std::array<int, MAX_TEXTURE_SLOTS> units;
+        for (uint32_t slot = 0; slot < MAX_TEXTURE_SLOTS; ++slot)
+            units[slot] = slot;
+        new_program->SetIntArray(new_program->GetUniformLocation("in_textures[0]"), units.data(), units.size());
+        program = new_program;
+    }
+    return program;
+}
 TexturePtr GetDefaultTexture() {
     uint8_t white_px[4] = { 255, 255, 255, 255 };
-    static TexturePtr t = Texture::Create(TextureInfo(TextureFormat::RGBA_8_32, 1, 1), white_px);
+    static TexturePtr t = Texture::Create(GetDefaultTextureInfo(), white_px);
     return t;
 }
 
@@ -84,43 +238,375 @@ static OglFramebuffer& GetFrameBuffer() {
 static const DrawList* m_drawlist;
 static GLuint m_vertex_buffer;
 static GLuint m_index_buffer;
-static GLuint m_array_object;
+static GLuint m_quad_buffer;
+static GLuint m_unit_quad_buffer;
+
+/**
+ * @brief A vertex array with the attribute layout of one program, and the GL state that it last pointed at.
+ * Calls that share a program and a buffer only re-point attributes when the base offset changes.
+ * Quad programs get their own arrays, so the instance divisors never leak into indexed draws.
+ */
+struct ProgramArray {
+    /// @brief Detects a new program that reuses the address of a destroyed one
+    std::weak_ptr<OglProgram> program;
+    GLuint vertex_array = 0;
+    /// @brief @ref m_geometry_generation when the attributes were last pointed
+    uint32_t generation = 0;
+    GLuint buffer = 0;
+    uintptr_t base = UINTPTR_MAX;
+    GLuint index_buffer = 0;
+
+    /// @brief Location of each attribute of the array's layout, resolved once
+    std::array<GLint, std::max(std::size(VERTEX_LAYOUT), std::size(QUAD_LAYOUT))> attribs;
+};
+static std::unordered_map<const OglProgram*, ProgramArray> m_program_arrays;
+/// @brief Changes whenever a geometry buffer is replaced, since GL may hand out the same name for the new one
+static uint32_t m_geometry_generation = 1;
+
+static GLuint m_frame_constants_buffer;
+/// @brief One aligned @ref BatchConstants for each distinct texture size and blend mode in the list
+static GLuint m_batch_constants_buffer;
+/// @brief Required alignment of buffer ranges bound to a uniform block
+static GLint m_uniform_offset_alignment = DEFAULT_UNIFORM_OFFSET_ALIGNMENT;
+static std::vector<uint8_t> m_batch_constants;
+/// @brief Byte offset of each call's @ref BatchConstants in @ref m_batch_constants_buffer
+static std::vector<uint32_t> m_call_batch_offsets;
+
+/** Fill and bind @ref m_frame_constants_buffer, and upload the batch constants of every call */
+static void UploadConstants(const glm::mat4& pixel_to_normalized);
+
+/** @return The vertex array for `program`, which is created on first use */
+static ProgramArray& GetProgramArray(const OglProgramPtr& program, bool is_quads);
+/** Delete the vertex arrays of programs that were destroyed */
+static void PurgeProgramArrays();
+/**
+ * @brief Point the attributes of `array` at `buffer`, unless they already point there
+ * @param base Byte offset of the first element in the buffer
+ */
+static void PointAttribs(ProgramArray& array, std::span<const VertexAttrib> layout,
+    GLsizei stride, GLuint buffer, uintptr_t base, GLuint divisor);
+
+/// @brief A copy of what was last uploaded to a buffer, so unchanged bytes aren't uploaded again
+struct ShadowBuffer {
+    std::vector<uint8_t> bytes;
+    /// @brief Allocated size of the GL buffer
+    size_t capacity = 0;
+};
+static ShadowBuffer m_vertex_shadow;
+static ShadowBuffer m_index_shadow;
+static ShadowBuffer m_quad_shadow;
+static UploadStats m_upload_stats;
+static FrameStats m_frame_stats;
+/** Finish @ref m_frame_stats with the draw list's size and the counters of the state cache */
+static void CollectFrameStats();
+/// @brief Changes larger than this fraction of a buffer replace the whole buffer, instead of a sub-range
+static constexpr float MAX_PARTIAL_UPLOAD = 0.5f;
+/// @brief Number of bytes compared at once, while searching for changes
+static constexpr size_t DIFF_BLOCK_SIZE = 256;
+
+/**
+ * @brief Upload only the bytes that changed since the last upload to the buffer bound at `target`
+ * @param shadow The buffer's shadow copy
+ */
+static void UploadBuffer(GLenum target, ShadowBuffer& shadow, const void* data, size_t size);
+
+/// @brief Number of frames that @ref UploadMode::STREAM can write ahead of the GPU
+static constexpr uint32_t FRAMES_IN_FLIGHT = 3;
+/// @brief How long to block on each wait for a fence, in nanoseconds
+static constexpr GLuint64 FENCE_TIMEOUT_NS = 1'000'000;
+
+/**
+ * @brief A buffer with one segment per frame in flight, for @ref UploadMode::STREAM.
+ * Each frame writes to the next segment, once the GPU is done with the frame that last used it.
+ */
+struct StreamBuffer {
+    GLuint buffer = 0;
+    /// @brief Size of each segment in bytes. The buffer holds @ref FRAMES_IN_FLIGHT segments.
+    size_t segment_size = 0;
+};
+static StreamBuffer m_vertex_stream;
+static StreamBuffer m_index_stream;
+static StreamBuffer m_quad_stream;
+/// @brief Signaled when the GPU finishes the last frame that used each segment
+static std::array<GLsync, FRAMES_IN_FLIGHT> m_stream_fences;
+static uint32_t m_stream_segment = 0;
+
+/**
+ * @brief Write data to the current segment of a stream buffer, growing the buffer if it doesn't fit
+ * @return Byte offset of the data in the buffer
+ */
+static size_t UploadStream(GLenum target, StreamBuffer& stream, const void* data, size_t size);
+/** Wait for the GPU to finish the last frame that read the current stream segment */
+static void WaitForStreamSegment();
+
+/// @brief A buffer that @ref Render reads one kind of geometry from, and the byte offset of the current list
+struct GeometrySource {
+    GLuint buffer = 0;
+    size_t offset = 0;
+};
+static GeometrySource m_vertex_source;
+static GeometrySource m_index_source;
+static GeometrySource m_quad_source;
+
+/** The default backend, which draws with OpenGL. Its state is in the statics above, since there's only one context. */
+class OglBackend : public Backend {
+public:
+    bool Setup() override;
+    void Cleanup() override;
+    void UploadDrawData(const DrawList& list) override;
+    void Render() override;
+    const UploadStats& GetUploadStats() const override { return m_upload_stats; }
+    const FrameStats& GetFrameStats() const override { return m_frame_stats; }
+};
+
+BackendPtr CreateOglBackend() { return std::make_unique<OglBackend>(); }
+
+static BackendPtr m_backend;
+static bool m_is_setup = false;
+
+Backend& GetBackend() {
+    if (!m_backend)
+        m_backend = CreateOglBackend();
+    return *m_backend;
+}
+
+void SetBackend(BackendPtr backend) {
+    const bool was_setup = m_is_setup;
+    Cleanup();
+    m_backend = std::move(backend);
+    if (was_setup)
+        Setup();
+}
 
 bool Setup() {
+    m_is_setup = GetBackend().Setup();
+    return m_is_setup;
+}
+
+void Cleanup() {
+    if (m_is_setup)
+        GetBackend().Cleanup();
+    m_is_setup = false;
+}
+
+void UploadDrawData(const DrawList& list) {
+    PROFILE_ZONE("Render2d::UploadDrawData");
+    GetBackend().UploadDrawData(list);
+}
+
+void Render() { GetBackend().Render(); }
+
+const UploadStats& GetUploadStats() { return GetBackend().GetUploadStats(); }
+const FrameStats& GetFrameStats() { return GetBackend().GetFrameStats(); }
+
+bool OglBackend::Setup() {
     glGenBuffers(1, &m_vertex_buffer);
     glGenBuffers(1, &m_index_buffer);
-    glGenVertexArrays(1, &m_array_object);
+    glGenBuffers(1, &m_quad_buffer);
+    glGenBuffers(1, &m_unit_quad_buffer);
+    glGenBuffers(1, &m_frame_constants_buffer);
+    glGenBuffers(1, &m_batch_constants_buffer);
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &m_uniform_offset_alignment);
+    m_uniform_offset_alignment = std::max(m_uniform_offset_alignment, 1);
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_unit_quad_buffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(UNIT_QUAD_CORNERS), UNIT_QUAD_CORNERS, GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
 
     return true;
 }
 
-void Cleanup() {
+void OglBackend::Cleanup() {
     if (m_vertex_buffer)
         glDeleteBuffers(1, &m_vertex_buffer);
     if (m_index_buffer)
         glDeleteBuffers(1, &m_index_buffer);
-    if (m_array_object)
-        glDeleteVertexArrays(1, &m_array_object);
+    if (m_quad_buffer)
+        glDeleteBuffers(1, &m_quad_buffer);
+    if (m_unit_quad_buffer)
+        glDeleteBuffers(1, &m_unit_quad_buffer);
+    if (m_frame_constants_buffer)
+        glDeleteBuffers(1, &m_frame_constants_buffer);
+    if (m_batch_constants_buffer)
+        glDeleteBuffers(1, &m_batch_constants_buffer);
+    for (auto& [program, array] : m_program_arrays)
+        glDeleteVertexArrays(1, &array.vertex_array);
+    m_program_arrays.clear();
+    m_vertex_shadow = {};
+    m_index_shadow = {};
+    m_quad_shadow = {};
+
+    for (StreamBuffer* stream : { &m_vertex_stream, &m_index_stream, &m_quad_stream }) {
+        if (stream->buffer)
+            glDeleteBuffers(1, &stream->buffer);
+        *stream = {};
+    }
+    for (GLsync& fence : m_stream_fences) {
+        if (fence)
+            glDeleteSync(fence);
+        fence = nullptr;
+    }
 }
 
-void UploadDrawData(const DrawList& list) {
+void OglBackend::UploadDrawData(const DrawList& list) {
     m_drawlist = &list;
     
+    m_upload_stats = {};
+
+    if (upload_mode == UploadMode::STREAM) {
+        m_stream_segment = (m_stream_segment + 1) % FRAMES_IN_FLIGHT;
+        WaitForStreamSegment();
+
+        // Each upload may replace its buffer while growing, so get the buffer afterwards
+        size_t vertex_offset = UploadStream(GL_ARRAY_BUFFER, m_vertex_stream,
+            list.vertices.data(), list.vertices.size() * sizeof(list.vertices[0]));
+        size_t index_offset = UploadStream(GL_ELEMENT_ARRAY_BUFFER, m_index_stream,
+            list.indices.data(), list.indices.size() * sizeof(list.indices[0]));
+        size_t quad_offset = UploadStream(GL_ARRAY_BUFFER, m_quad_stream,
+            list.quads.data(), list.quads.size() * sizeof(list.quads[0]));
+        m_vertex_source = { m_vertex_stream.buffer, vertex_offset };
+        m_index_source = { m_index_stream.buffer, index_offset };
+        m_quad_source = { m_quad_stream.buffer, quad_offset };
+
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+        return;
+    }
+
+    m_vertex_source = { m_vertex_buffer, 0 };
+    m_index_source = { m_index_buffer, 0 };
+    m_quad_source = { m_quad_buffer, 0 };
+    
     glBindBuffer(GL_ARRAY_BUFFER, m_vertex_buffer);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_index_buffer);
     
-    glBufferData(GL_ARRAY_BUFFER,
-        list.vertices.size() * sizeof(list.vertices[0]),
-        list.vertices.data(), GL_STREAM_DRAW);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-        list.indices.size() * sizeof(list.indices[0]),
-        list.indices.data(), GL_STREAM_DRAW);
+    UploadBuffer(GL_ARRAY_BUFFER, m_vertex_shadow,
+        list.vertices.data(), list.vertices.size() * sizeof(list.vertices[0]));
+    UploadBuffer(GL_ELEMENT_ARRAY_BUFFER, m_index_shadow,
+        list.indices.data(), list.indices.size() * sizeof(list.indices[0]));
+
+    if (!list.quads.empty()) {
+        glBindBuffer(GL_ARRAY_BUFFER, m_quad_buffer);
+        UploadBuffer(GL_ARRAY_BUFFER, m_quad_shadow,
+            list.quads.data(), list.quads.size() * sizeof(list.quads[0]));
+    }
 
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 }
 
-void Render() {
+static void WaitForStreamSegment() {
+#ifndef __EMSCRIPTEN__
+    // This rarely blocks, since the segment was last used a few frames ago
+    GLsync& fence = m_stream_fences[m_stream_segment];
+    if (!fence)
+        return;
+    GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+    if (result == GL_TIMEOUT_EXPIRED) {
+        ++m_upload_stats.fence_waits;
+        while (result == GL_TIMEOUT_EXPIRED)
+            result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT_NS);
+    }
+    glDeleteSync(fence);
+    fence = nullptr;
+#endif
+}
+
+static size_t UploadStream(GLenum target, StreamBuffer& stream, const void* data, size_t size) {
+    if (size == 0)
+        return 0;
+
+    if (size > stream.segment_size) {
+        // Replace the buffer with a larger one. GL keeps the old one alive until pending draws are done with it.
+        if (stream.buffer)
+            glDeleteBuffers(1, &stream.buffer);
+        glGenBuffers(1, &stream.buffer);
+        ++m_geometry_generation;
+        // Keep segments aligned for any element type
+        stream.segment_size = (size + size / 2 + 15) & ~(size_t)15;
+        glBindBuffer(target, stream.buffer);
+        glBufferData(target, stream.segment_size * FRAMES_IN_FLIGHT, nullptr, GL_STREAM_DRAW);
+    } else
+        glBindBuffer(target, stream.buffer);
+
+    const size_t offset = m_stream_segment * stream.segment_size;
+#ifdef __EMSCRIPTEN__
+    // WebGL can't map buffers, and it copies on upload anyway
+    glBufferSubData(target, offset, size, data);
+#else
+    // The fence already guarantees that the GPU is done with this range
+    void* dst = glMapBufferRange(target, offset, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    if (dst) {
+        memcpy(dst, data, size);
+        glUnmapBuffer(target);
+    } else
+        glBufferSubData(target, offset, size, data);
+#endif
+
+    ++m_upload_stats.full_uploads;
+    m_upload_stats.bytes_uploaded += size;
+    return offset;
+}
+
+/** @return Offset of the first byte that differs between `a` and `b` within `size`, or `size` if none do */
+static size_t FindFirstDifference(const uint8_t* a, const uint8_t* b, size_t size) {
+    size_t offset = 0;
+    while (offset + DIFF_BLOCK_SIZE <= size && memcmp(a + offset, b + offset, DIFF_BLOCK_SIZE) == 0)
+        offset += DIFF_BLOCK_SIZE;
+    while (offset < size && a[offset] == b[offset])
+        ++offset;
+    return offset;
+}
+
+/** @return One past the offset of the last byte that differs between `a` and `b` within `size`, or `0` if none do */
+static size_t FindLastDifference(const uint8_t* a, const uint8_t* b, size_t size) {
+    size_t end = size;
+    while (end >= DIFF_BLOCK_SIZE && memcmp(a + end - DIFF_BLOCK_SIZE, b + end - DIFF_BLOCK_SIZE, DIFF_BLOCK_SIZE) == 0)
+        end -= DIFF_BLOCK_SIZE;
+    while (end > 0 && a[end - 1] == b[end - 1])
+        --end;
+    return end;
+}
+
+static void UploadBuffer(GLenum target, ShadowBuffer& shadow, const void* data, size_t size) {
+    const uint8_t* bytes = (const uint8_t*)data;
+    const size_t old_size = shadow.bytes.size();
+
+    // Find the changed range. Bytes past the old size are always new.
+    const size_t compare_size = std::min(size, old_size);
+    size_t begin = FindFirstDifference(bytes, shadow.bytes.data(), compare_size);
+    size_t end = size;
+    if (size <= old_size)
+        end = begin + FindLastDifference(bytes + begin, shadow.bytes.data() + begin, compare_size - begin);
+
+    shadow.bytes.resize(size);
+    if (begin >= end) {
+        // Calls only read the current size, so anything after it may be stale
+        ++m_upload_stats.skipped_uploads;
+        m_upload_stats.bytes_skipped += size;
+        return;
+    }
+    memcpy(shadow.bytes.data() + begin, bytes + begin, end - begin);
+
+    if (size > shadow.capacity || end - begin > size * MAX_PARTIAL_UPLOAD) {
+        // Replace the whole buffer. Re-specifying its storage lets the driver skip waiting on the GPU.
+        if (size > shadow.capacity)
+            shadow.capacity = size + size / 2;
+        glBufferData(target, shadow.capacity, nullptr, GL_STREAM_DRAW);
+        glBufferSubData(target, 0, size, bytes);
+        ++m_upload_stats.full_uploads;
+        m_upload_stats.bytes_uploaded += size;
+        return;
+    }
+
+    glBufferSubData(target, begin, end - begin, bytes + begin);
+    ++m_upload_stats.partial_uploads;
+    m_upload_stats.bytes_uploaded += end - begin;
+    m_upload_stats.bytes_skipped += size - (end - begin);
+}
+
+void OglBackend::Render() {
+    PROFILE_GPU_ZONE("Render2d::Render");
     float aspect = m_screen_w / m_screen_h;
 
     glm::mat4x4 m;
@@ -134,85 +620,122 @@ void Render() {
         m = glm::ortho<float>(0, m_screen_w, m_screen_h, 0, 1, -1);
     }
 
+    // Create the defaults first, since creating them changes state behind the cache
+    GetDefaultProgram();
+    GetDefaultQuadProgram();
+    GetDefaultTexture();
 
-    glViewport(0, 0, m_screen_w, m_screen_h);
-    glBindVertexArray(m_array_object);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_index_buffer);
-    glBindBuffer(GL_ARRAY_BUFFER, m_vertex_buffer);
+    // Other renderers may have changed any state since the last frame
+    OglState::Invalidate();
+    OglState::ResetStats();
+    m_frame_stats = {};
+    PurgeProgramArrays();
 
-    for (const DrawCall& call : m_drawlist->calls) {
-        // Bind program
-        OglProgramPtr program = call.params.program;
-        if (program == nullptr)
-            program = GetDefaultProgram();
-        glUseProgram(program->GlHandle());
-
-        // Bind texture
-        TexturePtr current_tex = call.params.texture;
-        if (!current_tex)
-            current_tex = GetDefaultTexture();
+    glViewport(0, 0, m_screen_w, m_screen_h);
+    UploadConstants(m);
+
+    for (size_t call_index = 0; call_index < m_drawlist->calls.size(); ++call_index) {
+        const DrawCall& call = m_drawlist->calls[call_index];
+        const bool is_quads = call.params.primitive == Primitive::QUADS;
+
+        // Find program. It's bound after its uniforms are set, so they're sent all at once.
+        OglProgramPtr program_ptr = m_drawlist->programs[call.params.program];
+        assert((!is_quads || program_ptr == nullptr) && "Quads only support the default program");
+        if (program_ptr == nullptr)
+            program_ptr = is_quads ? GetDefaultQuadProgram() : GetDefaultProgram();
+        OglProgram* program = program_ptr.get();
+        ProgramArray& array = GetProgramArray(program_ptr, is_quads);
+
+        // Bind texture. Quads bind a whole set of textures, which all share the first one's blend mode.
+        const TextureSlots* slots = nullptr;
+        ResourceHandle texture = call.params.texture;
+        if (is_quads) {
+            slots = &m_drawlist->texture_slots[call.params.texture];
+            texture = slots->textures[0];
+        }
+        Texture* current_tex = ResolveTexture(texture);
         
         if (current_tex->GetInfo().premul)
-            glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+            OglState::BlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
         else if (render_target)
-            glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE_MINUS_DST_ALPHA, GL_ONE);
+            OglState::BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE_MINUS_DST_ALPHA, GL_ONE);
         else 
-            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            OglState::BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
         BindShaderParams(*m_drawlist, call, program);
         
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, current_tex->GlHandle());
-
-        program->SetVec2(program->GetUniformLocation("resolution"), glm::vec2{m_screen_w, m_screen_h});
-        program->SetMat4(program->GetUniformLocation("pixel_to_normalized"), m);
-        program->SetVec2(
-            program->GetUniformLocation("texel_to_normalized"),
-            glm::vec2{1.f / current_tex->GetInfo().width, 1.f / current_tex->GetInfo().height}
-        );
-
-        GLint attrib_in_pos = program->GetAttribLocation("in_pos");
-        GLint attrib_in_uv = program->GetAttribLocation("in_uv");
-        GLint attrib_in_color = program->GetAttribLocation("in_color");
-        
-        // Bind array attributes
-        if (attrib_in_pos != -1) {
-            glEnableVertexAttribArray(attrib_in_pos);
-            glVertexAttribPointer(attrib_in_pos,   2, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<void*>(0));
-        }
-        if (attrib_in_uv != -1) {
-            glEnableVertexAttribArray(attrib_in_uv);
-            glVertexAttribPointer(attrib_in_uv,    2, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<void*>(2 * sizeof(float)));
-        }
-        if (attrib_in_color != -1) {
-            glEnableVertexAttribArray(attrib_in_color);
-            glVertexAttribPointer(attrib_in_color, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<void*>(4 * sizeof(float)));
-        }
+        if (slots) {
+            for (uint8_t slot = 0; slot < slots->count; ++slot)
+                OglState::BindTexture(slot, ResolveTexture(slots->textures[slot])->GlHandle());
+        } else
+            OglState::BindTexture(0, current_tex->GlHandle());
+
+        OglState::BindUniformBuffer(BATCH_CONSTANTS_BINDING, m_batch_constants_buffer,
+            m_call_batch_offsets[call_index], sizeof(BatchConstants));
+        program->Use();
+
 
         // Clip geometry
-        if (glm::isnan(call.params.clip.x))
-            glDisable(GL_SCISSOR_TEST);
+        const glm::vec4& clip = m_drawlist->clips[call.params.clip];
+        if (call.params.clip == DEFAULT_HANDLE)
+            OglState::EnableScissor(false);
         else {
-            glEnable(GL_SCISSOR_TEST);
+            OglState::EnableScissor(true);
             // glScissor uses y=0 as the bottom of the screen
             
             glm::vec<4, int32_t> irect;
             for (int i = 0; i < 4; ++i)
-                irect[i] = (int32_t)glm::round(call.params.clip[i]);
+                irect[i] = (int32_t)glm::round(clip[i]);
 
-            float new_y = irect.y;
+            int32_t new_y = irect.y;
             if (!render_target)
-                new_y = m_screen_h - irect.y - irect[3];
-            glScissor(irect.x, new_y, irect[2], irect[3]);
+                new_y = (int32_t)m_screen_h - irect.y - irect[3];
+            OglState::Scissor(irect.x, new_y, irect[2], irect[3]);
+        }
+
+        OglState::BindVertexArray(array.vertex_array);
+        if (is_quads) {
+            // Point the instance attributes at the call's first quad.
+            // This works in place of a base instance, which WebGL2 lacks.
+            PointAttribs(array, QUAD_LAYOUT, sizeof(Quad),
+                m_quad_source.buffer, m_quad_source.offset + (uintptr_t)call.quad_offset * sizeof(Quad), 1);
+            glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, call.quad_count);
+        } else {
+            // The element buffer is part of the vertex array
+            if (array.index_buffer != m_index_source.buffer || array.generation != m_geometry_generation) {
+                array.index_buffer = m_index_source.buffer;
+                glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_index_source.buffer);
+            } else
+                OglState::CountSkipped();
+            // Bind array attributes, starting at the call's vertex chunk.
+            // This works in place of glDrawElementsBaseVertex, which WebGL2 lacks.
+            PointAttribs(array, VERTEX_LAYOUT, sizeof(Vertex),
+                m_vertex_source.buffer, m_vertex_source.offset + (uintptr_t)call.vertex_offset * sizeof(Vertex), 0);
+
+            static_assert(sizeof(Index) == sizeof(GLushort));
+            glDrawElements(GL_TRIANGLES, call.index_count, GL_UNSIGNED_SHORT, (void*)(m_index_source.offset + call.index_offset * sizeof(Index)));
         }
+    }
 
-        glDrawElements(GL_TRIANGLES, call.index_count, GL_UNSIGNED_INT, (void*)(call.index_offset * sizeof(GLuint)));
+#ifndef __EMSCRIPTEN__
+    // Mark when the GPU is done reading this frame's segment
+    if (upload_mode == UploadMode::STREAM) {
+        GLsync& fence = m_stream_fences[m_stream_segment];
+        if (fence)
+            glDeleteSync(fence);
+        fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
     }
+#endif
 
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
     glDisable(GL_SCISSOR_TEST);
     glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glActiveTexture(GL_TEXTURE0);
     glUseProgram(0);
+    // Other renderers will change state behind the cache
+    OglState::Invalidate();
+    CollectFrameStats();
 
     GLenum err;
     while ((err = glGetError()) != GL_NO_ERROR) {
@@ -220,24 +743,175 @@ void Render() {
     }
 }
 
-static void BindShaderParams(const DrawList& drawlist, const DrawCall& call, OglProgramPtr program) {
-    for (uint32_t i = 0; i < call.sp_count; ++i) {
-        const ShaderParam& sp = drawlist.shader_params.items[i + call.sp_offset];
+static void UploadConstants(const glm::mat4& pixel_to_normalized) {
+    FrameConstants frame = {};
+    frame.pixel_to_normalized = pixel_to_normalized;
+    frame.resolution = glm::vec2{m_screen_w, m_screen_h};
+    frame.time = m_time;
+    glBindBuffer(GL_UNIFORM_BUFFER, m_frame_constants_buffer);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(frame), &frame, GL_STREAM_DRAW);
+    m_frame_stats.bytes_uploaded += sizeof(frame);
+    OglState::BindUniformBuffer(FRAME_CONSTANTS_BINDING, m_frame_constants_buffer, 0, sizeof(frame));
+
+    // Calls that share a texture size and blend mode share a range
+    const size_t stride = (sizeof(BatchConstants) + m_uniform_offset_alignment - 1) / m_uniform_offset_alignment * m_uniform_offset_alignment;
+    std::unordered_map<uint64_t, uint32_t> offsets;
+    m_batch_constants.clear();
+    m_call_batch_offsets.resize(m_drawlist->calls.size());
+    for (size_t i = 0; i < m_drawlist->calls.size(); ++i) {
+        const DrawCall& call = m_drawlist->calls[i];
+        ResourceHandle texture = call.params.texture;
+        if (call.params.primitive == Primitive::QUADS)
+            texture = m_drawlist->texture_slots[texture].textures[0];
+        const TextureInfo& info = ResolveTexture(texture)->GetInfo();
+
+        auto [it, inserted] = offsets.try_emplace(GetBatchConstantsKey(info), (uint32_t)m_batch_constants.size());
+        m_call_batch_offsets[i] = it->second;
+        if (!inserted)
+            continue;
+
+        // `in_uv` is already normalized. This is only for user programs that need the texel size.
+        BatchConstants batch = {};
+        batch.texel_to_normalized = glm::vec2{1.f / info.width, 1.f / info.height};
+        batch.premultiplied = info.premul;
+        m_batch_constants.resize(m_batch_constants.size() + stride);
+        memcpy(m_batch_constants.data() + it->second, &batch, sizeof(batch));
+    }
+
+    if (!m_batch_constants.empty()) {
+        glBindBuffer(GL_UNIFORM_BUFFER, m_batch_constants_buffer);
+        glBufferData(GL_UNIFORM_BUFFER, m_batch_constants.size(), m_batch_constants.data(), GL_STREAM_DRAW);
+        m_frame_stats.bytes_uploaded += m_batch_constants.size();
+    }
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+template <class T>
+static void AddListBytes(const std::vector<T>& vector) {
+    m_frame_stats.list_size += vector.size() * sizeof(T);
+    m_frame_stats.list_capacity += vector.capacity() * sizeof(T);
+}
+
+static void CollectFrameStats() {
+    const DrawList& list = *m_drawlist;
+    m_frame_stats.vertices = (uint32_t)list.vertices.size();
+    m_frame_stats.indices = (uint32_t)list.indices.size();
+    m_frame_stats.quads = (uint32_t)list.quads.size();
+    m_frame_stats.draw_calls = (uint32_t)list.calls.size();
+
+    const OglState::Stats& state = OglState::GetStats();
+    m_frame_stats.shader_param_uploads = state.uniform_uploads;
+    m_frame_stats.texture_binds = state.texture_binds;
+    m_frame_stats.program_switches = state.program_switches;
+    m_frame_stats.scissor_changes = state.scissor_changes;
+    m_frame_stats.bytes_uploaded += m_upload_stats.bytes_uploaded;
+
+    AddListBytes(list.vertices);
+    AddListBytes(list.indices);
+    AddListBytes(list.quads);
+    AddListBytes(list.calls);
+    AddListBytes(list.shader_params.data);
+}
+
+static ProgramArray& GetProgramArray(const OglProgramPtr& program, bool is_quads) {
+    auto [it, inserted] = m_program_arrays.try_emplace(program.get());
+    ProgramArray& array = it->second;
+    if (!inserted && !array.program.expired())
+        return array;
+
+    if (!inserted) {
+        // Deleting a bound array would bind `0` behind the cache
+        OglState::BindVertexArray(0);
+        glDeleteVertexArrays(1, &array.vertex_array);
+    }
+    array = {};
+    array.program = program;
+    std::span<const VertexAttrib> layout = VERTEX_LAYOUT;
+    if (is_quads)
+        layout = QUAD_LAYOUT;
+    for (size_t i = 0; i < layout.size(); ++i)
+        array.attribs[i] = program->GetAttribLocation(layout[i].name);
+    // Every program reads the shared constants from the same binding points
+    program->BindUniformBlock("FrameConstants", FRAME_CONSTANTS_BINDING);
+    program->BindUniformBlock("BatchConstants", BATCH_CONSTANTS_BINDING);
+
+    glGenVertexArrays(1, &array.vertex_array);
+    if (is_quads) {
+        // Every instance shares the unit quad, so its attribute never moves
+        static constexpr VertexAttrib corner = { "in_corner", 2, GL_FLOAT, GL_FALSE, 0 };
+        const GLint corner_location = program->GetAttribLocation(corner.name);
+        OglState::BindVertexArray(array.vertex_array);
+        OglState::BindArrayBuffer(m_unit_quad_buffer);
+        BindAttribs({ &corner, 1 }, &corner_location, 0, 0, 0);
+    }
+    return array;
+}
+
+static void PurgeProgramArrays() {
+    std::erase_if(m_program_arrays, [](const auto& entry) {
+        const ProgramArray& array = entry.second;
+        if (!array.program.expired())
+            return false;
+        glDeleteVertexArrays(1, &array.vertex_array);
+        return true;
+    });
+}
+
+static void PointAttribs(ProgramArray& array, std::span<const VertexAttrib> layout,
+    GLsizei stride, GLuint buffer, uintptr_t base, GLuint divisor) {
+    if (array.buffer == buffer && array.base == base && array.generation == m_geometry_generation) {
+        OglState::CountSkipped();
+        return;
+    }
+    array.buffer = buffer;
+    array.base = base;
+    array.generation = m_geometry_generation;
+    OglState::BindArrayBuffer(buffer);
+    BindAttribs(layout, array.attribs.data(), stride, base, divisor);
+}
+
+/**
+ * @brief Enable and point each attribute of `layout` that a program uses into the bound array buffer
+ * @param locations Location of each attribute in the program, or `-1` if it's unused
+ * @param base Byte offset of the first element in the buffer
+ * @param divisor `0` for per-vertex attributes, or `1` for per-instance attributes
+ */
+static void BindAttribs(std::span<const VertexAttrib> layout, const GLint* locations, GLsizei stride, uintptr_t base, GLuint divisor) {
+    for (size_t i = 0; i < layout.size(); ++i) {
+        const VertexAttrib& attrib = layout[i];
+        GLint location = locations[i];
+        if (location == -1)
+            continue;
+        glEnableVertexAttribArray(location);
+        glVertexAttribPointer(location, attrib.size, attrib.type, attrib.normalized, stride, reinterpret_cast<void*>(base + attrib.offset));
+        glVertexAttribDivisor(location, divisor);
+    }
+}
+
+static Texture* ResolveTexture(ResourceHandle texture) {
+    Texture* ptr = m_drawlist->textures[texture].get();
+    return ptr ? ptr : GetDefaultTexture().get();
+}
+
+static void BindShaderParams(const DrawList& drawlist, const DrawCall& call, OglProgram* program) {
+    const ShaderParamList& params = drawlist.shader_params;
+    for (uint32_t offset = call.sp_offset; offset < call.sp_offset + call.sp_size; offset += params.GetParam(offset).size) {
+        const ShaderParam sp = params.GetParam(offset);
         switch (sp.type) {
         case ShaderParamType::INT:
-            program->SetInt(sp.id, drawlist.shader_params.sp_int[sp.index]); break;
+            program->SetInt(sp.id, params.GetValue<int>(offset)); break;
         case ShaderParamType::FLOAT:
-            program->SetFloat(sp.id, drawlist.shader_params.sp_float[sp.index]); break;
+            program->SetFloat(sp.id, params.GetValue<float>(offset)); break;
         case ShaderParamType::VEC2:
-            program->SetVec2(sp.id, drawlist.shader_params.sp_vec2[sp.index]); break;
+            program->SetVec2(sp.id, params.GetValue<glm::vec2>(offset)); break;
         case ShaderParamType::VEC3:
-            program->SetVec3(sp.id, drawlist.shader_params.sp_vec3[sp.index]); break;
+            program->SetVec3(sp.id, params.GetValue<glm::vec3>(offset)); break;
         case ShaderParamType::VEC4:
-            program->SetVec4(sp.id, drawlist.shader_params.sp_vec4[sp.index]); break;
+            program->SetVec4(sp.id, params.GetValue<glm::vec4>(offset)); break;
         case ShaderParamType::MAT3X3:
-            program->SetMat3(sp.id, drawlist.shader_params.sp_mat3x3[sp.index]); break;
+            program->SetMat3(sp.id, params.GetValue<glm::mat3x3>(offset)); break;
         case ShaderParamType::MAT4X4:
-            program->SetMat4(sp.id, drawlist.shader_params.sp_mat4x4[sp.index]); break;
+            program->SetMat4(sp.id, params.GetValue<glm::mat4x4>(offset)); break;
         default:
             PLATFORM_ERROR("Unknown ShaderParamType");
         }
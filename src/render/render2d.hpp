@@ -3,21 +3,117 @@
 #include "opengl/forward.hpp"
 #include "render2d_list.hpp"
 #include "render2d_draw.hpp"
+#include <memory>
+
+/**
+ * @brief GLSL of the uniform block that @ref Render2d::Render fills once per frame.
+ * Programs that declare it read the shared values, instead of setting uniforms on every call.
+ */
+#define RENDER2D_FRAME_CONSTANTS_GLSL \
+    "layout(std140) uniform FrameConstants {\n" \
+    "   highp mat4 pixel_to_normalized;\n" \
+    "   highp vec2 resolution;\n" \
+    "   highp float time;\n" \
+    "};\n"
+/** @brief GLSL of the uniform block that @ref Render2d::Render fills for each call's texture */
+#define RENDER2D_BATCH_CONSTANTS_GLSL \
+    "layout(std140) uniform BatchConstants {\n" \
+    "   highp vec2 texel_to_normalized;\n" \
+    "   bool premultiplied;\n" \
+    "};\n"
 
 namespace Render2d {
     inline float m_screen_w = 0;
     inline float m_screen_h = 0;
+    /// @brief Seconds since some fixed point, as seen by shaders through `time`
+    inline float m_time = 0;
     /// @brief `nullptr` will render to the screen
     inline TexturePtr render_target = nullptr;
     static const TextureFormat OUTPUT_FORMAT = TextureFormat::RGBA_8_32;
 
+    /// @brief How @ref UploadDrawData sends geometry to the GPU
+    enum class UploadMode {
+        /// @brief Keep one set of buffers, and only upload the bytes that changed since the last list
+        CHANGES,
+        /**
+         * @brief Write every list to a new segment of a larger buffer, without reallocating it or waiting on the driver.
+         * Fences keep the CPU from overwriting a segment until the GPU is done with it, a few frames later.
+         */
+        STREAM,
+    };
+    inline UploadMode upload_mode = UploadMode::CHANGES;
+
+    /// @brief Uniform buffer binding point of @ref RENDER2D_FRAME_CONSTANTS_GLSL, which every program shares
+    static constexpr GLuint FRAME_CONSTANTS_BINDING = 0;
+    /// @brief Uniform buffer binding point of @ref RENDER2D_BATCH_CONSTANTS_GLSL, which every program shares
+    static constexpr GLuint BATCH_CONSTANTS_BINDING = 1;
+
+    class Backend;
+    using BackendPtr = std::unique_ptr<Backend>;
+
+    /** Set up the current backend, which is the OpenGL backend unless @ref SetBackend chose another */
     bool Setup();
     void Cleanup();
     void PreRender();
     void PostRender();
     OglShaderPtr GetDefaultVertShader();
+    OglShaderPtr GetDefaultQuadVertShader();
     OglShaderPtr GetDefaultFragShader();
+    OglShaderPtr GetDefaultQuadFragShader();
 
+    /// @brief What the last @ref UploadDrawData sent to the GPU
+    struct UploadStats {
+        /// @brief Bytes sent with `glBufferData` or `glBufferSubData`
+        size_t bytes_uploaded = 0;
+        /// @brief Bytes that were already on the GPU
+        size_t bytes_skipped = 0;
+        /// @brief Number of buffers that were replaced
+        uint32_t full_uploads = 0;
+        /// @brief Number of buffers where only a changed range was uploaded
+        uint32_t partial_uploads = 0;
+        /// @brief Number of buffers that were unchanged
+        uint32_t skipped_uploads = 0;
+        /// @brief Number of times that @ref UploadMode::STREAM waited for the GPU to finish an older frame
+        uint32_t fence_waits = 0;
+    };
+
+    /// @brief Work done by the last @ref UploadDrawData and @ref Render
+    struct FrameStats {
+        uint32_t vertices = 0;
+        uint32_t indices = 0;
+        uint32_t quads = 0;
+        uint32_t draw_calls = 0;
+        /**
+         * @brief Uniforms sent to GL, including shader params and program defaults.
+         * The null backend only counts the shader params of the list, since it doesn't know what the programs already hold.
+         */
+        uint32_t shader_param_uploads = 0;
+        uint32_t texture_binds = 0;
+        uint32_t program_switches = 0;
+        /// @brief Changes of the scissor rect or scissor test
+        uint32_t scissor_changes = 0;
+        /// @brief Bytes of geometry and uniform buffers sent to GL
+        size_t bytes_uploaded = 0;
+        /// @brief Bytes used by the draw list's geometry, calls and shader params
+        size_t list_size = 0;
+        /// @brief Bytes allocated for the same arrays as @ref list_size
+        size_t list_capacity = 0;
+    };
+
+    /**
+     * @brief Upload a draw list's geometry for @ref Render. The list must stay alive until then.
+     * The OpenGL backend compares each buffer with the last upload, so unchanged lists upload nothing and small changes only upload the changed range.
+     */
     void UploadDrawData(const DrawList& list);
+    const UploadStats& GetUploadStats();
     void Render();
+    const FrameStats& GetFrameStats();
+
+    /**
+     * @brief Replace the backend that lists are submitted to.
+     * If Render2d is already set up, the old backend is cleaned up and the new one is set up.
+     */
+    void SetBackend(BackendPtr backend);
+    /** @return The backend that lists are submitted to */
+    Backend& GetBackend();
 }
\ No newline at end of file
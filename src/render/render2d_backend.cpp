@@ -0,0 +1,313 @@
+#include "render2d_backend.hpp"
+#include "texture.hpp"
+#include <platform.hpp>
+#include <profiler.hpp>
+#include <fnv1a.hpp>
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <optional>
+#include <unordered_set>
+#include <string>
+#include <utility>
+
+namespace Render2d {
+
+/** Set `*out_error` from a `printf` format, if it's given. @return `false` */
+static bool Fail(std::string* out_error, const char* format, ...) {
+    if (!out_error)
+        return false;
+    char buf[256];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+    *out_error = buf;
+    return false;
+}
+
+/** Check the shader param records within a call's byte range */
+static bool ValidateShaderParams(const ShaderParamList& params, const DrawCall& call, size_t call_index, std::string* out_error) {
+    const uint64_t end = (uint64_t)call.sp_offset + call.sp_size;
+    if (end > params.Size())
+        return Fail(out_error, "Call %zu: shader params %u+%u are outside the list's %u bytes", call_index, call.sp_offset, call.sp_size, params.Size());
+
+    for (uint64_t offset = call.sp_offset; offset < end;) {
+        if (offset % ShaderParamList::ALIGNMENT != 0 || offset + sizeof(ShaderParam) > end)
+            return Fail(out_error, "Call %zu: shader param at byte %llu is misaligned or cut off", call_index, (unsigned long long)offset);
+        const ShaderParam param = params.GetParam((uint32_t)offset);
+        if (param.type > ShaderParamType::MAT4X4)
+            return Fail(out_error, "Call %zu: shader param at byte %llu has unknown type %u", call_index, (unsigned long long)offset, (unsigned)param.type);
+        if (param.size < sizeof(ShaderParam) + GetShaderParamSize(param.type) || offset + param.size > end)
+            return Fail(out_error, "Call %zu: shader param at byte %llu has a bad size of %u", call_index, (unsigned long long)offset, param.size);
+        offset += param.size;
+    }
+    return true;
+}
+
+bool ValidateDrawList(const DrawList& list, std::string* out_error) {
+    if (list.textures.empty() || list.textures[DEFAULT_HANDLE] != nullptr)
+        return Fail(out_error, "The first texture should be the default, nullptr");
+    if (list.programs.empty() || list.programs[DEFAULT_HANDLE] != nullptr)
+        return Fail(out_error, "The first program should be the default, nullptr");
+    if (list.clips.empty())
+        return Fail(out_error, "The first clip should be NO_CLIP");
+
+    for (size_t i = 0; i < list.calls.size(); ++i) {
+        const DrawCall& call = list.calls[i];
+        const DrawCallParams& params = call.params;
+        if (params.program >= list.programs.size())
+            return Fail(out_error, "Call %zu: program %u is outside the list's %zu", i, params.program, list.programs.size());
+        if (params.clip >= list.clips.size())
+            return Fail(out_error, "Call %zu: clip %u is outside the list's %zu", i, params.clip, list.clips.size());
+        if (!ValidateShaderParams(list.shader_params, call, i, out_error))
+            return false;
+
+        switch (params.primitive) {
+        case Primitive::TRIANGLES: {
+            if (params.texture >= list.textures.size())
+                return Fail(out_error, "Call %zu: texture %u is outside the list's %zu", i, params.texture, list.textures.size());
+            if (call.index_count % 3 != 0)
+                return Fail(out_error, "Call %zu: %u indices don't make whole triangles", i, call.index_count);
+            if ((uint64_t)call.index_offset + call.index_count > list.indices.size())
+                return Fail(out_error, "Call %zu: indices %u+%u are outside the list's %zu", i, call.index_offset, call.index_count, list.indices.size());
+            const Index* indices = list.indices.data() + call.index_offset;
+            for (uint32_t j = 0; j < call.index_count; ++j) {
+                if ((uint64_t)call.vertex_offset + indices[j] >= list.vertices.size())
+                    return Fail(out_error, "Call %zu: index %u points at vertex %llu, outside the list's %zu", i,
+                        call.index_offset + j, (unsigned long long)call.vertex_offset + indices[j], list.vertices.size());
+            }
+            break;
+        }
+        case Primitive::QUADS: {
+            if (params.program != DEFAULT_HANDLE)
+                return Fail(out_error, "Call %zu: quads only support the default program", i);
+            if (params.texture >= list.texture_slots.size())
+                return Fail(out_error, "Call %zu: texture slots %u are outside the list's %zu", i, params.texture, list.texture_slots.size());
+            const TextureSlots& slots = list.texture_slots[params.texture];
+            if (slots.count == 0 || slots.count > MAX_TEXTURE_SLOTS)
+                return Fail(out_error, "Call %zu: %u texture slots are in use", i, slots.count);
+            for (uint8_t slot = 0; slot < slots.count; ++slot) {
+                if (slots.textures[slot] >= list.textures.size())
+                    return Fail(out_error, "Call %zu: slot %u holds texture %u, outside the list's %zu", i, slot, slots.textures[slot], list.textures.size());
+            }
+            if ((uint64_t)call.quad_offset + call.quad_count > list.quads.size())
+                return Fail(out_error, "Call %zu: quads %u+%u are outside the list's %zu", i, call.quad_offset, call.quad_count, list.quads.size());
+            for (uint32_t j = 0; j < call.quad_count; ++j) {
+                if (list.quads[call.quad_offset + j].slot >= slots.count)
+                    return Fail(out_error, "Call %zu: quad %u uses empty slot %u", i, call.quad_offset + j, list.quads[call.quad_offset + j].slot);
+            }
+            break;
+        }
+        default:
+            return Fail(out_error, "Call %zu: unknown primitive %u", i, (unsigned)params.primitive);
+        }
+    }
+    return true;
+}
+
+template <class T>
+static void AddListBytes(FrameStats& stats, const std::vector<T>& vector) {
+    stats.list_size += vector.size() * sizeof(T);
+    stats.list_capacity += vector.capacity() * sizeof(T);
+}
+
+void NullBackend::UploadDrawData(const DrawList& list) {
+    std::string error;
+    m_drawlist = nullptr;
+    m_upload_stats = {};
+    if (!ValidateDrawList(list, &error)) {
+        ++m_invalid_lists;
+        PLATFORM_WARNING("Invalid draw list: " + error);
+        return;
+    }
+    m_drawlist = &list;
+
+    // Every buffer is counted as replaced, since there's nothing to compare with
+    for (size_t size : { list.vertices.size() * sizeof(Vertex), list.indices.size() * sizeof(Index), list.quads.size() * sizeof(Quad) }) {
+        if (size == 0)
+            continue;
+        m_upload_stats.bytes_uploaded += size;
+        ++m_upload_stats.full_uploads;
+    }
+}
+
+void NullBackend::Render() {
+    PROFILE_ZONE("Render2d::NullBackend::Render");
+    m_frame_stats = {};
+    if (!m_drawlist)
+        return;
+    const DrawList& list = *m_drawlist;
+
+    // Follow the state that the OpenGL backend would set, starting from an unknown state
+    std::optional<std::pair<const OglProgram*, bool>> program;
+    std::array<std::optional<const Texture*>, MAX_TEXTURE_SLOTS> textures;
+    std::optional<bool> scissor_enabled;
+    std::optional<glm::ivec4> scissor;
+    // Calls that share a texture size and blend mode share a range of the batch constants
+    std::unordered_set<uint64_t> batch_keys;
+
+    auto bind_texture = [&](uint8_t unit, ResourceHandle handle) {
+        const Texture* texture = list.textures[handle].get();
+        if (textures[unit] != texture) {
+            textures[unit] = texture;
+            ++m_frame_stats.texture_binds;
+        }
+    };
+
+    for (const DrawCall& call : list.calls) {
+        const bool is_quads = call.params.primitive == Primitive::QUADS;
+        // The default program differs between triangles and quads
+        const std::pair<const OglProgram*, bool> call_program = { list.programs[call.params.program].get(), is_quads };
+        if (program != call_program) {
+            program = call_program;
+            ++m_frame_stats.program_switches;
+        }
+
+        if (is_quads) {
+            const TextureSlots& slots = list.texture_slots[call.params.texture];
+            for (uint8_t slot = 0; slot < slots.count; ++slot)
+                bind_texture(slot, slots.textures[slot]);
+        } else
+            bind_texture(0, call.params.texture);
+
+        ResourceHandle batch_texture = call.params.texture;
+        if (is_quads)
+            batch_texture = list.texture_slots[batch_texture].textures[0];
+        const Texture* texture = list.textures[batch_texture].get();
+        batch_keys.insert(GetBatchConstantsKey(texture ? texture->GetInfo() : GetDefaultTextureInfo()));
+
+        // Shader params are counted as sent, though the program may skip values it already has
+        for (uint32_t offset = call.sp_offset; offset < call.sp_offset + call.sp_size; offset += list.shader_params.GetParam(offset).size)
+            ++m_frame_stats.shader_param_uploads;
+
+        const bool enable = call.params.clip != DEFAULT_HANDLE;
+        if (scissor_enabled != enable) {
+            scissor_enabled = enable;
+            ++m_frame_stats.scissor_changes;
+        }
+        if (enable) {
+            const glm::ivec4 rect = glm::ivec4(glm::round(list.clips[call.params.clip]));
+            if (scissor != rect) {
+                scissor = rect;
+                ++m_frame_stats.scissor_changes;
+            }
+        }
+    }
+
+    m_frame_stats.vertices = (uint32_t)list.vertices.size();
+    m_frame_stats.indices = (uint32_t)list.indices.size();
+    m_frame_stats.quads = (uint32_t)list.quads.size();
+    m_frame_stats.draw_calls = (uint32_t)list.calls.size();
+    // The frame constants, and one aligned batch block per key, go to uniform buffers
+    const size_t batch_stride = (sizeof(BatchConstants) + DEFAULT_UNIFORM_OFFSET_ALIGNMENT - 1)
+        / DEFAULT_UNIFORM_OFFSET_ALIGNMENT * DEFAULT_UNIFORM_OFFSET_ALIGNMENT;
+    m_frame_stats.bytes_uploaded = m_upload_stats.bytes_uploaded + sizeof(FrameConstants) + batch_keys.size() * batch_stride;
+    AddListBytes(m_frame_stats, list.vertices);
+    AddListBytes(m_frame_stats, list.indices);
+    AddListBytes(m_frame_stats, list.quads);
+    AddListBytes(m_frame_stats, list.calls);
+    AddListBytes(m_frame_stats, list.shader_params.data);
+}
+
+void RecordingBackend::Write(const char* format, ...) {
+    char buf[512];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+    if (length < 0)
+        return;
+    m_recording.append(buf, std::min<size_t>(length, sizeof(buf) - 1));
+    m_recording += '\n';
+}
+
+template <class T>
+static unsigned long long HashVector(const std::vector<T>& vector) {
+    return fnv1a::Hash_64(vector.size() * sizeof(T), (const uint8_t*)vector.data());
+}
+
+void RecordingBackend::UploadDrawData(const DrawList& list) {
+    NullBackend::UploadDrawData(list);
+    if (!m_drawlist) {
+        Write("upload invalid");
+        return;
+    }
+    Write("upload vertices=%zu:%016llx indices=%zu:%016llx quads=%zu:%016llx",
+        list.vertices.size(), HashVector(list.vertices),
+        list.indices.size(), HashVector(list.indices),
+        list.quads.size(), HashVector(list.quads));
+}
+
+/** Describe a texture by its handle and size, since its address and GL name change between runs */
+static std::string DescribeTexture(const DrawList& list, ResourceHandle handle) {
+    const Texture* texture = list.textures[handle].get();
+    if (!texture)
+        return std::to_string(handle) + "(default)";
+    const TextureInfo& info = texture->GetInfo();
+    return std::to_string(handle) + "(" + std::to_string(info.width) + "x" + std::to_string(info.height)
+        + (info.premul ? " premul)" : ")");
+}
+
+/** Format a shader param's value as its floats or ints, separated by spaces */
+static std::string DescribeShaderParam(const ShaderParamList& params, uint32_t offset) {
+    static const char* TYPE_NAMES[] = { "int", "float", "vec2", "vec3", "vec4", "mat3", "mat4" };
+    const ShaderParam param = params.GetParam(offset);
+    std::string text = TYPE_NAMES[(size_t)param.type];
+    char buf[32];
+    if (param.type == ShaderParamType::INT) {
+        snprintf(buf, sizeof(buf), " %d", params.GetValue<int>(offset));
+        return text + buf;
+    }
+    const uint32_t count = GetShaderParamSize(param.type) / sizeof(float);
+    for (uint32_t i = 0; i < count; ++i) {
+        float value;
+        memcpy(&value, params.data.data() + offset + sizeof(ShaderParam) + i * sizeof(float), sizeof(value));
+        snprintf(buf, sizeof(buf), " %g", value);
+        text += buf;
+    }
+    return text;
+}
+
+void RecordingBackend::Render() {
+    NullBackend::Render();
+    std::string target = "screen";
+    if (render_target)
+        target = std::to_string(render_target->GetInfo().width) + "x" + std::to_string(render_target->GetInfo().height);
+    Write("render %u size=%gx%g target=%s time=%g", m_frame_index++, m_screen_w, m_screen_h, target.c_str(), m_time);
+    if (!m_drawlist)
+        return;
+
+    const DrawList& list = *m_drawlist;
+    for (size_t i = 0; i < list.calls.size(); ++i) {
+        const DrawCall& call = list.calls[i];
+        std::string clip = "none";
+        if (call.params.clip != DEFAULT_HANDLE) {
+            const glm::vec4& rect = list.clips[call.params.clip];
+            char buf[96];
+            snprintf(buf, sizeof(buf), "%g,%g,%g,%g", rect.x, rect.y, rect.z, rect.w);
+            clip = buf;
+        }
+
+        if (call.params.primitive == Primitive::QUADS) {
+            const TextureSlots& slots = list.texture_slots[call.params.texture];
+            std::string textures;
+            for (uint8_t slot = 0; slot < slots.count; ++slot)
+                textures += (slot ? "," : "") + DescribeTexture(list, slots.textures[slot]);
+            Write("call %zu quads textures=[%s] clip=%s quads=%u+%u", i, textures.c_str(), clip.c_str(), call.quad_offset, call.quad_count);
+        } else {
+            Write("call %zu triangles program=%u texture=%s clip=%s indices=%u+%u vertex_offset=%u", i, call.params.program,
+                DescribeTexture(list, call.params.texture).c_str(), clip.c_str(), call.index_offset, call.index_count, call.vertex_offset);
+        }
+
+        const ShaderParamList& params = list.shader_params;
+        for (uint32_t offset = call.sp_offset; offset < call.sp_offset + call.sp_size; offset += params.GetParam(offset).size)
+            Write("  param %d %s", params.GetParam(offset).id, DescribeShaderParam(params, offset).c_str());
+    }
+}
+
+}
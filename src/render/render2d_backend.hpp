@@ -0,0 +1,116 @@
+#pragma once
+#include "render2d.hpp"
+#include "texture.hpp"
+#include <glm/glm.hpp>
+#include <string>
+
+namespace Render2d {
+    /**
+     * @brief Where @ref UploadDrawData and @ref Render send a draw list.
+     * Backends read the frame's state, such as @ref m_screen_w and @ref render_target, from Render2d.
+     */
+    class Backend {
+    public:
+        virtual ~Backend() {}
+
+        virtual bool Setup() = 0;
+        virtual void Cleanup() = 0;
+        /** Take a list's geometry. The list stays alive until the next @ref Render. */
+        virtual void UploadDrawData(const DrawList& list) = 0;
+        /** Draw the calls of the last uploaded list */
+        virtual void Render() = 0;
+        virtual const UploadStats& GetUploadStats() const = 0;
+        virtual const FrameStats& GetFrameStats() const = 0;
+    };
+
+    /** @return The backend that draws with OpenGL, which is the default */
+    BackendPtr CreateOglBackend();
+
+    /**
+     * @brief A backend that checks each list and counts the work that OpenGL would do, without calling GL.
+     * This runs the whole submit path on machines without a GPU, and measures the CPU time that isn't spent in the driver.
+     */
+    class NullBackend : public Backend {
+    public:
+        bool Setup() override { return true; }
+        void Cleanup() override {}
+        /** Validate the list. An invalid list is reported, and the next @ref Render draws nothing. */
+        void UploadDrawData(const DrawList& list) override;
+        /**
+         * @brief Count the calls, state changes and uploads that the OpenGL backend would issue.
+         * Batch constants are counted at @ref DEFAULT_UNIFORM_OFFSET_ALIGNMENT, and uniforms only as the list's shader params.
+         */
+        void Render() override;
+        const UploadStats& GetUploadStats() const override { return m_upload_stats; }
+        const FrameStats& GetFrameStats() const override { return m_frame_stats; }
+
+        /// @return Number of uploaded lists that failed validation
+        uint32_t GetInvalidLists() const { return m_invalid_lists; }
+
+    protected:
+        /// @brief The last uploaded list, or `nullptr` if it was invalid
+        const DrawList* m_drawlist = nullptr;
+
+    private:
+        UploadStats m_upload_stats;
+        FrameStats m_frame_stats;
+        uint32_t m_invalid_lists = 0;
+    };
+
+    /**
+     * @brief A @ref NullBackend that also writes the submitted command stream as text, one command per line.
+     * Geometry is written as sizes and hashes, so recordings of the same frames can be compared with `diff`.
+     */
+    class RecordingBackend : public NullBackend {
+    public:
+        void UploadDrawData(const DrawList& list) override;
+        void Render() override;
+
+        const std::string& GetRecording() const { return m_recording; }
+        void ClearRecording() { m_recording.clear(); }
+
+    private:
+        /** Append one line to the recording, formatted as by `printf` */
+        void Write(const char* format, ...);
+
+        std::string m_recording;
+        uint32_t m_frame_index = 0;
+    };
+
+    /**
+     * @brief Check that every handle, offset and index of a list is in range, and that its shader params are well formed
+     * @param out_error Will be set to a description of the first problem, if there is one
+     * @return `true` if the list is valid
+     */
+    bool ValidateDrawList(const DrawList& list, std::string* out_error = nullptr);
+
+    /// @brief Contents of @ref RENDER2D_FRAME_CONSTANTS_GLSL, in std140 layout
+    struct FrameConstants {
+        glm::mat4 pixel_to_normalized;
+        glm::vec2 resolution;
+        float time;
+        float _padding;
+    };
+    static_assert(sizeof(FrameConstants) == 80, "FrameConstants should match its std140 layout");
+
+    /// @brief Contents of @ref RENDER2D_BATCH_CONSTANTS_GLSL, in std140 layout
+    struct BatchConstants {
+        glm::vec2 texel_to_normalized;
+        uint32_t premultiplied;
+        uint32_t _padding;
+    };
+    static_assert(sizeof(BatchConstants) == 16, "BatchConstants should match its std140 layout");
+
+    /// @brief Alignment of uniform buffer ranges that is assumed until, or without, a GL context to ask
+    constexpr int DEFAULT_UNIFORM_OFFSET_ALIGNMENT = 256;
+
+    /** @return Info of the texture that calls without a texture draw with, a single white pixel */
+    inline TextureInfo GetDefaultTextureInfo() {
+        return TextureInfo(TextureFormat::RGBA_8_32, 1, 1);
+    }
+
+    /** @return Key of the @ref BatchConstants that calls drawing `info` share, since they only depend on its size and blending */
+    inline uint64_t GetBatchConstantsKey(const TextureInfo& info) {
+        return (uint64_t)info.width << 33 | (uint64_t)info.height << 1 | info.premul;
+    }
+}
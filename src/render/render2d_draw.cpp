@@ -1,84 +1,75 @@
 #include "render2d_draw.hpp"
+#include "render2d.hpp"
+#include "render2d_fragment.hpp"
 #include "font/fontmanager.hpp"
 #include "font/fontatlas.hpp"
 #include "font/font.hpp"
+#include "transform.hpp"
 #include "glm/glm.hpp"
 #include "glm/ext/vector_float2.hpp"
 #include "glm/ext/scalar_constants.hpp"
 #include <render/texture.hpp>
 #include <resources/resource.hpp>
 #include <array>
+#include <algorithm>
 
 // Debugging
 #include <iostream>
 
 namespace Render2d {
 
-static constexpr std::array<uint32_t, 6> rect_indices = { 0,1,2,2,3,0 };
+static constexpr std::array<Index, 6> rect_indices = { 0,1,2,2,3,0 };
 static constexpr std::array<glm::vec2, 4> rect_wh = { glm::vec2{0.f,0.f}, {1,0}, {1,1}, {0,1} };
+/// @brief Maximum distance in pixels between a Bézier curve and its segments
+static constexpr float BEZIER_TOLERANCE = 0.25f;
+static constexpr uint32_t MAX_BEZIER_SEGMENTS = 256;
+/// @brief Smallest cosine between a miter and its segment's normal. Sharper joins are limited to this length.
+static constexpr float MIN_MITER_DOT = 0.25f;
 
 Draw::Draw() {}
 
 void Draw::Clear() {
-    m_drawlist.indices.clear();
-    m_drawlist.vertices.clear();
-    m_drawlist.calls.clear();
-    m_drawlist.shader_params.Clear();
+    m_drawlist.Clear();
+    m_texture_handles.clear();
+    m_program_handles.clear();
+    m_clip_handles.clear();
 
     m_clip_stack.clear();
     m_transforms.clear();
     m_params = {};
+    m_texture = DEFAULT_HANDLE;
+    m_clip = DEFAULT_HANDLE;
+    m_texture_slots = NO_TEXTURE_SLOTS;
+    m_vertex_base = 0;
+    m_texel_scale = glm::vec2(0);
 
     ResetColor();
 }
 
-void Draw::SetProgram(OglProgramPtr program) {
+void Draw::SetProgram(const OglProgramPtr& program) {
+    ResourceHandle handle = GetHandle(m_drawlist.programs, m_program_handles, program);
+    if (handle == m_params.program)
+        return;
     m_dirty_params = true;
-    m_params.program = program;
+    m_params.program = handle;
 }
 
-void Draw::SetColor(const glm::vec4& rgba) { m_rgba = rgba; }
+void Draw::SetColor(const glm::vec4& rgba) { m_color = PackColor(rgba); }
 
 void Draw::PushClip(glm::vec4 new_clip) {
-    m_dirty_params = true;
-    if (!glm::isnan(new_clip.x) && !glm::isnan(m_params.clip.x)) {
-        // Clamp `new_clip` within the boundaries of the current `m_clip_rect`
-        // using { x0,y0, x1,y1 } format
-        glm::vec4 old_corners = glm::vec4(
-            m_params.clip[0], m_params.clip[1],
-            m_params.clip[0] + m_params.clip[2], m_params.clip[1] + m_params.clip[3]
-        );
-        glm::vec4 new_corners = glm::vec4(new_clip[0], new_clip[1], new_clip[0] + new_clip[2], new_clip[1] + new_clip[3]);
-
-        // Top-left
-        for (uint8_t tl = 0; tl < 2; ++tl) {
-            if (new_corners[tl] < old_corners[tl])
-                new_corners[tl] = old_corners[tl];
-        }
-
-        // Bottom-right
-        for (uint8_t br = 2; br < 4; ++br) {
-            if (new_corners[br] > old_corners[br])
-                new_corners[br] = old_corners[br];
-        }
-
-        // Use { x, y, w, h } format again
-        new_clip = new_corners;
-        new_clip[2] -= new_clip[0];
-        new_clip[3] -= new_clip[1];
-    }
-
+    const glm::vec4 old_clip = m_drawlist.clips[m_clip];
+    if (!glm::isnan(new_clip.x) && !glm::isnan(old_clip.x))
+        new_clip = ClampClip(new_clip, old_clip);
     
-    m_clip_stack.emplace_back(m_params.clip);
-    m_params.clip = new_clip;
+    m_clip_stack.emplace_back(m_clip);
+    m_clip = GetClipHandle(new_clip);
 }
 
 void Draw::PopClip() {
-    m_dirty_params = true;
     assert(!m_clip_stack.empty() && "Too many pops");
-    glm::vec4 prev_clip = m_clip_stack.back();
+    ResourceHandle prev_clip = m_clip_stack.back();
     m_clip_stack.pop_back();
-    m_params.clip = prev_clip;
+    m_clip = prev_clip;
 }
 
 void Draw::Codepoint(FontHandle font, codepoint_t codepoint, glm::vec2 top_left) {
@@ -103,10 +94,9 @@ void Draw::Codepoint(FontHandle font, codepoint_t codepoint, glm::vec2 top_left)
     
     SetTexture(atlas->GetTexture());
     
-    uint32_t index_off = m_drawlist.vertices.size();
-    RectUv(top_left, glm::vec2(rect.w, rect.h), glm::vec2(rect.x, rect.y), glm::vec2(rect.w, rect.h));
-    
-    AddDrawCall(rect_indices.size());
+    size_t first_vertex = m_drawlist.vertices.size();
+    AddRect(top_left, glm::vec2(rect.w, rect.h), glm::vec2(rect.x, rect.y), glm::vec2(rect.w, rect.h));
+    ApplyTransform(first_vertex);
 }
 
 void Draw::TextUnicode(FontHandle font, glm::vec2 top_left, std::u32string_view text) {
@@ -133,7 +123,7 @@ void Draw::TextInternal(FontHandle font, glm::vec2 top_left, const void* begin,
 
     float hcursor = top_left.x;
     float vcursor = top_left.y + line_ascent;
-    uint32_t indices_start = m_drawlist.indices.size();
+    size_t first_vertex = m_drawlist.vertices.size();
 
     SetTexture(atlas->GetTexture());
 
@@ -176,14 +166,15 @@ void Draw::TextInternal(FontHandle font, glm::vec2 top_left, const void* begin,
             glm::vec2 glyph_tex_size = glm::vec2(glyph_rect.w, glyph_rect.h);
             glm::vec2 glyph_pixel_pos = glm::round(glyph_pos);
 
-            RectUv(glyph_pixel_pos, glyph_tex_size, glyph_uv, glyph_tex_size);
+            // Add each glyph separately, in case the run crosses into a new vertex chunk
+            AddRect(glyph_pixel_pos, glyph_tex_size, glyph_uv, glyph_tex_size);
         }
 
         hcursor += glyph->metrics.next_x_offset * atlas->GetScale();
     }
 
-    uint32_t num_indices = m_drawlist.indices.size() - indices_start;
-    AddDrawCall(num_indices);
+    // Transform the whole run at once
+    ApplyTransform(first_vertex);
 }
 
 void Draw::DebugFontAtlas(FontHandle font, glm::vec2 top_left, glm::vec2 size) {
@@ -196,7 +187,7 @@ void Draw::Rect(glm::vec2 top_left, glm::vec2 size) {
     TextureRect(nullptr, top_left, size);
 }
 
-void Draw::TextureRect(TexturePtr texture, glm::vec2 top_left, glm::vec2 size) {
+void Draw::TextureRect(const TexturePtr& texture, glm::vec2 top_left, glm::vec2 size) {
     glm::vec2 tex_size = glm::vec2(0);
     if (texture != nullptr)
         tex_size = glm::vec2(texture->GetInfo().width, texture->GetInfo().height);
@@ -208,15 +199,16 @@ void Draw::TextureRect(TexturePtr texture, glm::vec2 top_left, glm::vec2 size) {
     }
 
     SetTexture(texture);
-    RectUv(top_left, size, glm::vec2(0), tex_size);
-    AddDrawCall(rect_indices.size());
+    size_t first_vertex = m_drawlist.vertices.size();
+    AddRect(top_left, size, glm::vec2(0), tex_size);
+    ApplyTransform(first_vertex);
 }
 
 void Draw::Ellipse(uint32_t num_points, glm::vec2 top_left, glm::vec2 size) {
     TextureEllipse(nullptr, num_points, top_left, size);
 }
 
-void Draw::TextureEllipse(TexturePtr texture, uint32_t num_points, glm::vec2 top_left, glm::vec2 size) {
+void Draw::TextureEllipse(const TexturePtr& texture, uint32_t num_points, glm::vec2 top_left, glm::vec2 size) {
     glm::vec2 tex_size = glm::vec2(0);
     if (texture != nullptr)
         tex_size = glm::vec2(texture->GetInfo().width, texture->GetInfo().height);
@@ -228,24 +220,438 @@ void Draw::TextureEllipse(TexturePtr texture, uint32_t num_points, glm::vec2 top
     }
     
     uint32_t prev_num_indices = m_drawlist.indices.size();
+    size_t first_vertex = m_drawlist.vertices.size();
 
     SetTexture(texture);
     EllipseUv(num_points, top_left, size, glm::vec2(0), tex_size);
+    ApplyTransform(first_vertex);
+    if (CullTriangles(first_vertex, prev_num_indices))
+        return;
     AddDrawCall(m_drawlist.indices.size()- prev_num_indices);
 }
 
-void Draw::RectUv(glm::vec2 xy, glm::vec2 size, glm::vec2 uv, glm::vec2 uv_wh) {
-    uint32_t index_off = m_drawlist.vertices.size();
+void Draw::RoundedRect(glm::vec2 top_left, glm::vec2 size, float radius) {
+    AddShape(QuadShape::ROUNDED_RECT, top_left, size, radius, 0, 0);
+}
+
+void Draw::RectOutline(glm::vec2 top_left, glm::vec2 size, float thickness, float radius) {
+    AddShape(QuadShape::ROUNDED_RECT, top_left, size, radius, thickness, 0);
+}
+
+void Draw::Ellipse(glm::vec2 top_left, glm::vec2 size) {
+    AddShape(QuadShape::ELLIPSE, top_left, size, 0, 0, 0);
+}
+
+void Draw::EllipseOutline(glm::vec2 top_left, glm::vec2 size, float thickness) {
+    AddShape(QuadShape::ELLIPSE, top_left, size, 0, thickness, 0);
+}
+
+void Draw::Shadow(glm::vec2 top_left, glm::vec2 size, float softness, float radius) {
+    // Grow the quad so the blur fades out at its edges
+    AddShape(QuadShape::ROUNDED_RECT, top_left - softness, size + softness * 2.f, radius, 0, softness);
+}
+
+void Draw::Polyline(std::span<const glm::vec2> points, float thickness, bool closed) {
+    m_stroke_points.assign(points.begin(), points.end());
+    if (!m_transforms.empty() && !m_stroke_points.empty())
+        TransformPoints(&m_stroke_points[0].x, m_stroke_points.size(), sizeof(glm::vec2), m_transforms.back());
+    StrokeInternal(thickness * GetTransformScale(), closed);
+}
+
+void Draw::Bezier(glm::vec2 p0, glm::vec2 p1, glm::vec2 p2, glm::vec2 p3, float thickness) {
+    glm::vec2 ctrl[4] = { p0, p1, p2, p3 };
+    if (!m_transforms.empty())
+        TransformPoints(&ctrl[0].x, 4, sizeof(glm::vec2), m_transforms.back());
+    thickness *= GetTransformScale();
+
+    // The curve is within its control points, so skip it early if they're hidden
+    const float margin = thickness / 2 + 1;
+    glm::vec2 min = glm::min(glm::min(ctrl[0], ctrl[1]), glm::min(ctrl[2], ctrl[3]));
+    glm::vec2 max = glm::max(glm::max(ctrl[0], ctrl[1]), glm::max(ctrl[2], ctrl[3]));
+    if (IsHidden(min - margin, max + margin))
+        return;
+
+    // Choose enough segments to stay within a fraction of a pixel of the true curve
+    const float curvature = glm::max(
+        glm::length(ctrl[0] - 2.f * ctrl[1] + ctrl[2]),
+        glm::length(ctrl[1] - 2.f * ctrl[2] + ctrl[3])
+    );
+    const uint32_t num_segments = (uint32_t)glm::clamp(
+        glm::ceil(glm::sqrt(0.75f * curvature / BEZIER_TOLERANCE)), 1.f, (float)MAX_BEZIER_SEGMENTS
+    );
+
+    m_stroke_points.resize(num_segments + 1);
+    for (uint32_t i = 0; i <= num_segments; ++i) {
+        float t = (float)i / num_segments;
+        float u = 1 - t;
+        m_stroke_points[i] = u*u*u * ctrl[0] + 3*u*u*t * ctrl[1] + 3*u*t*t * ctrl[2] + t*t*t * ctrl[3];
+    }
+    StrokeInternal(thickness, false);
+}
+
+void Draw::Append(const DrawList& list, const glm::vec4& tint) {
+    const DrawCallParams saved_params = m_params;
+    const ResourceHandle saved_texture = m_texture;
+    const ResourceHandle saved_clip = m_clip;
+    const std::array<uint8_t, 4> packed_tint = PackColor(tint);
+    const size_t first_vertex = m_drawlist.vertices.size();
+
+    // Map each of the list's handles to a handle in our own tables
+    std::vector<ResourceHandle> textures(list.textures.size());
+    std::vector<ResourceHandle> programs(list.programs.size());
+    std::vector<ResourceHandle> clips(list.clips.size());
+    for (size_t i = 0; i < textures.size(); ++i)
+        textures[i] = GetHandle(m_drawlist.textures, m_texture_handles, list.textures[i]);
+    for (size_t i = 0; i < programs.size(); ++i)
+        programs[i] = GetHandle(m_drawlist.programs, m_program_handles, list.programs[i]);
+    const glm::vec4 current_clip = m_drawlist.clips[saved_clip];
+    clips[DEFAULT_HANDLE] = saved_clip;
+    for (size_t i = 1; i < clips.size(); ++i) {
+        glm::vec4 clip = list.clips[i];
+        if (!m_transforms.empty() && !glm::isnan(clip.x))
+            clip = TransformClip(clip, m_transforms.back());
+        if (!glm::isnan(current_clip.x))
+            clip = ClampClip(clip, current_clip);
+        clips[i] = GetClipHandle(clip);
+    }
+
+    for (const DrawCall& call : list.calls) {
+        // The texture, clip, and primitive are set along with the geometry
+        ResourceHandle program = programs[call.params.program];
+        if (program != m_params.program) {
+            m_params.program = program;
+            m_dirty_params = true;
+        }
+        m_clip = clips[call.params.clip];
+
+        // New shader params also start a new call
+        if (m_drawlist.shader_params.Append(list.shader_params, call.sp_offset, call.sp_size, program))
+            m_dirty_params = true;
+
+        if (call.params.primitive == Primitive::QUADS)
+            AppendQuads(list, call, textures, packed_tint);
+        else {
+            m_texture = textures[call.params.texture];
+            AppendTriangles(list, call);
+        }
+    }
+
+    // Tint and transform every new vertex in bulk
+    if (packed_tint != std::array<uint8_t, 4>{ 255, 255, 255, 255 }) {
+        for (size_t i = first_vertex; i < m_drawlist.vertices.size(); ++i)
+            TintColor(&m_drawlist.vertices[i].r, packed_tint);
+    }
+    ApplyTransform(first_vertex);
+
+    m_texture = saved_texture;
+    m_clip = saved_clip;
+    if (m_params != saved_params) {
+        m_params = saved_params;
+        m_dirty_params = true;
+    }
+}
+
+void Draw::AppendFragment(const DrawFragment& fragment, const glm::vec4& tint) {
+    Append(fragment.GetDrawList(), tint);
+}
+
+void Draw::AppendTriangles(const DrawList& list, const DrawCall& call) {
+    if (call.index_count == 0)
+        return;
+
+    const Index* src_indices = &list.indices[call.index_offset];
+    Index min_index = *std::min_element(src_indices, src_indices + call.index_count);
+    Index max_index = *std::max_element(src_indices, src_indices + call.index_count);
+
+    // Calls merged by ReorderCalls may skip over the vertices of other calls, so only copy the vertices that are used
+    static constexpr uint32_t UNUSED = UINT32_MAX;
+    m_vertex_remap.assign((size_t)max_index - min_index + 1, UNUSED);
+    uint32_t num_vertices = 0;
+    for (uint32_t i = 0; i < call.index_count; ++i) {
+        uint32_t& remapped = m_vertex_remap[src_indices[i] - min_index];
+        if (remapped == UNUSED)
+            remapped = num_vertices++;
+    }
+
+    Index index_off = ReserveVertices(num_vertices);
+    const size_t first_vertex = m_drawlist.vertices.size();
+    m_drawlist.vertices.resize(first_vertex + num_vertices);
+    const Vertex* src_vertices = &list.vertices[call.vertex_offset + min_index];
+    for (uint32_t v = 0; v < m_vertex_remap.size(); ++v) {
+        if (m_vertex_remap[v] != UNUSED)
+            m_drawlist.vertices[first_vertex + m_vertex_remap[v]] = src_vertices[v];
+    }
+
+    size_t first_index = m_drawlist.indices.size();
+    m_drawlist.indices.resize(first_index + call.index_count);
+    Index* dst_indices = &m_drawlist.indices[first_index];
+    for (uint32_t i = 0; i < call.index_count; ++i)
+        dst_indices[i] = (Index)(m_vertex_remap[src_indices[i] - min_index] + index_off);
+
+    AddDrawCall(call.index_count);
+}
+
+void Draw::AppendQuads(const DrawList& list, const DrawCall& call, const std::vector<ResourceHandle>& textures, const std::array<uint8_t, 4>& tint) {
+    if (call.quad_count == 0)
+        return;
+
+    const TextureSlots& src_slots = list.texture_slots[call.params.texture];
+    const Quad* src_quads = &list.quads[call.quad_offset];
+    if (CanUseQuads()) {
+        for (uint32_t q = 0; q < call.quad_count; ++q) {
+            Quad quad = src_quads[q];
+            if (!m_transforms.empty())
+                TransformQuad(quad, m_transforms.back());
+            TintColor(&quad.r, tint);
+            PushQuad(quad, textures[src_slots.textures[quad.slot]]);
+        }
+        return;
+    }
+
+    // Expand each quad into triangles, which are transformed and tinted later with the other vertices
+    for (uint32_t q = 0; q < call.quad_count; ++q) {
+        const Quad& quad = src_quads[q];
+        m_texture = textures[src_slots.textures[quad.slot]];
+        if (quad.shape != (uint8_t)QuadShape::RECT) {
+            size_t first_index = m_drawlist.indices.size();
+            ShapeUv(quad);
+            AddDrawCall(m_drawlist.indices.size() - first_index);
+            continue;
+        }
+
+        Index index_off = ReserveVertices(rect_wh.size());
+        for (const glm::vec2& wh : rect_wh) {
+            m_drawlist.vertices.emplace_back(Vertex{
+                quad.x + quad.w * wh.x, quad.y + quad.h * wh.y,
+                wh.x == 0 ? quad.u0 : quad.u1, wh.y == 0 ? quad.v0 : quad.v1,
+                quad.r, quad.g, quad.b, quad.a
+            });
+        }
+        for (Index index : rect_indices)
+            m_drawlist.indices.push_back(index + index_off);
+        AddDrawCall(rect_indices.size());
+    }
+}
+
+void Draw::AddRect(glm::vec2 xy, glm::vec2 size, glm::vec2 uv, glm::vec2 uv_wh) {
+    if (CanUseQuads()) {
+        if (m_transforms.empty())
+            AddQuad(xy, size, uv, uv_wh);
+        else {
+            // The transform only scales and translates, so it maps the rect's corner and size directly
+            const glm::mat3& tform = m_transforms.back();
+            glm::vec2 scale = glm::vec2(tform[0][0], tform[1][1]);
+            AddQuad(xy * scale + glm::vec2(tform[2]), size * scale, uv, uv_wh);
+        }
+        return;
+    }
+
+    RectUv(xy, size, uv, uv_wh);
+    AddDrawCall(rect_indices.size());
+}
+
+bool Draw::CanUseQuads() const {
+    // User programs only understand the Vertex layout
+    if (!m_instanced_quads || m_params.program != DEFAULT_HANDLE)
+        return false;
+    if (m_transforms.empty())
+        return true;
+    const glm::mat3& tform = m_transforms.back();
+    return tform[0][1] == 0 && tform[1][0] == 0
+        && tform[0][2] == 0 && tform[1][2] == 0 && tform[2][2] == 1;
+}
+
+void Draw::AddQuad(glm::vec2 xy, glm::vec2 size, glm::vec2 uv, glm::vec2 uv_wh) {
+    glm::vec2 uv0 = uv * m_texel_scale;
+    glm::vec2 uv1 = (uv + uv_wh) * m_texel_scale;
+    PushQuad(Quad{
+        xy.x, xy.y, size.x, size.y,
+        PackUnorm16(uv0.x), PackUnorm16(uv0.y), PackUnorm16(uv1.x), PackUnorm16(uv1.y),
+        m_color[0], m_color[1], m_color[2], m_color[3],
+        0, (uint8_t)QuadShape::RECT, 0, 0, 0
+    }, m_texture);
+}
+
+void Draw::AddShape(QuadShape shape, glm::vec2 xy, glm::vec2 size, float radius, float border, float softness) {
+    SetTexture(nullptr);
+    Quad quad = {
+        xy.x, xy.y, size.x, size.y,
+        0, 0, 0, 0,
+        m_color[0], m_color[1], m_color[2], m_color[3],
+        0, (uint8_t)shape, PackShapeUnits(radius), PackShapeUnits(border), PackShapeUnits(softness)
+    };
+
+    if (CanUseQuads()) {
+        if (!m_transforms.empty())
+            TransformQuad(quad, m_transforms.back());
+        PushQuad(quad, m_texture);
+        return;
+    }
+
+    size_t first_vertex = m_drawlist.vertices.size();
+    size_t first_index = m_drawlist.indices.size();
+    ShapeUv(quad);
+    ApplyTransform(first_vertex);
+    if (CullTriangles(first_vertex, first_index))
+        return;
+    AddDrawCall(m_drawlist.indices.size() - first_index);
+}
+
+void Draw::TransformQuad(Quad& quad, const glm::mat3& tform) {
+    const glm::vec2 scale = glm::vec2(tform[0][0], tform[1][1]);
+    quad.x = quad.x * scale.x + tform[2].x;
+    quad.y = quad.y * scale.y + tform[2].y;
+    quad.w *= scale.x;
+    quad.h *= scale.y;
+    if (quad.shape == (uint8_t)QuadShape::RECT)
+        return;
+
+    // Shape distances are scaled evenly, which is only exact for uniform scales
+    const float shape_scale = (glm::abs(scale.x) + glm::abs(scale.y)) / 2.f;
+    for (uint16_t* units : { &quad.radius, &quad.border, &quad.softness })
+        *units = PackShapeUnits(*units / SHAPE_UNITS_PER_PIXEL * shape_scale);
+}
+
+void Draw::PushQuad(Quad quad, ResourceHandle texture) {
+    ResourceHandle clip = m_clip;
+    if (m_cpu_clipping) {
+        const glm::vec4& clip_rect = m_drawlist.clips[m_clip];
+        Quad trimmed = quad;
+        if (glm::isnan(clip_rect.x)) {
+            // Drop quads that are off the screen. The viewport already clips the rest.
+            const glm::vec2 corner = glm::vec2(quad.x, quad.y), far_corner = corner + glm::vec2(quad.w, quad.h);
+            if (IsHidden(glm::min(corner, far_corner), glm::max(corner, far_corner)))
+                return;
+        } else if (!ClipQuad(trimmed, clip_rect))
+            return;
+        // Trimming would distort a shape, so partially visible shapes still need the scissor
+        const bool is_trimmed = trimmed.x != quad.x || trimmed.y != quad.y || trimmed.w != quad.w || trimmed.h != quad.h;
+        if (quad.shape == (uint8_t)QuadShape::RECT || !is_trimmed) {
+            quad = trimmed;
+            clip = DEFAULT_HANDLE;
+        }
+    }
+    quad.slot = GetTextureSlot(texture);
+    m_drawlist.quads.emplace_back(quad);
+    SetCallParams(Primitive::QUADS, m_texture_slots, clip);
+    AddQuadCall(1);
+}
+
+bool Draw::ClipQuad(Quad& quad, const glm::vec4& clip) {
+    // Find the visible range of each axis, as a fraction of the quad's size.
+    // This also works for flipped quads, with a negative size.
+    float range[2][2];
+    const float pos[2] = { quad.x, quad.y };
+    const float size[2] = { quad.w, quad.h };
+    for (int axis = 0; axis < 2; ++axis) {
+        if (size[axis] == 0)
+            return false;
+        float t0 = (clip[axis] - pos[axis]) / size[axis];
+        float t1 = (clip[axis] + clip[axis + 2] - pos[axis]) / size[axis];
+        range[axis][0] = glm::clamp(glm::min(t0, t1), 0.f, 1.f);
+        range[axis][1] = glm::clamp(glm::max(t0, t1), 0.f, 1.f);
+        if (range[axis][0] >= range[axis][1])
+            return false;
+    }
+
+    // Fully visible
+    if (range[0][0] == 0 && range[0][1] == 1 && range[1][0] == 0 && range[1][1] == 1)
+        return true;
+
+    auto lerp_unorm16 = [](uint16_t a, uint16_t b, float t) {
+        return (uint16_t)(a + (b - a) * t + 0.5f);
+    };
+    uint16_t u0 = quad.u0, v0 = quad.v0;
+    quad.u0 = lerp_unorm16(u0, quad.u1, range[0][0]);
+    quad.u1 = lerp_unorm16(u0, quad.u1, range[0][1]);
+    quad.v0 = lerp_unorm16(v0, quad.v1, range[1][0]);
+    quad.v1 = lerp_unorm16(v0, quad.v1, range[1][1]);
+    quad.x += quad.w * range[0][0];
+    quad.y += quad.h * range[1][0];
+    quad.w *= range[0][1] - range[0][0];
+    quad.h *= range[1][1] - range[1][0];
+    return true;
+}
+
+bool Draw::IsHidden(glm::vec2 min, glm::vec2 max) const {
+    // User programs may not use pixel coordinates
+    if (m_params.program != DEFAULT_HANDLE)
+        return false;
+    glm::vec4 clip = m_drawlist.clips[m_clip];
+    if (glm::isnan(clip.x)) {
+        // Only draws with CPU clipping are known to be in screen space. Fragments are recorded in their own space.
+        if (!m_cpu_clipping || m_screen_w <= 0 || m_screen_h <= 0)
+            return false;
+        clip = glm::vec4(0, 0, m_screen_w, m_screen_h);
+    }
+    return max.x <= clip.x || min.x >= clip.x + clip.z || max.y <= clip.y || min.y >= clip.y + clip.w;
+}
+
+bool Draw::CullTriangles(size_t first_vertex, size_t first_index) {
+    if (!m_cpu_clipping)
+        return false;
+
+    glm::vec2 min = glm::vec2(INFINITY), max = glm::vec2(-INFINITY);
+    for (size_t i = first_vertex; i < m_drawlist.vertices.size(); ++i) {
+        glm::vec2 pos = glm::vec2(m_drawlist.vertices[i].x, m_drawlist.vertices[i].y);
+        min = glm::min(min, pos);
+        max = glm::max(max, pos);
+    }
+
+    if (!IsHidden(min, max))
+        return false;
     
-    for (const glm::vec2& wh : rect_wh) {
-        PushVertex(Vertex{
-            xy.x + size.x * wh.x, xy.y + size.y * wh.y,
-            uv.x + uv_wh.x * wh.x , uv.y + uv_wh.y * wh.y,
-            m_rgba[0], m_rgba[1], m_rgba[2], m_rgba[3]
-        });
+    m_drawlist.vertices.resize(first_vertex);
+    m_drawlist.indices.resize(first_index);
+    return true;
+}
+
+uint8_t Draw::GetTextureSlot(ResourceHandle texture) {
+    const TexturePtr& texture_ptr = m_drawlist.textures[texture];
+    const bool premultiplied = texture_ptr != nullptr && texture_ptr->GetInfo().premul;
+    const uint32_t max_slots = m_texture_batching ? MAX_TEXTURE_SLOTS : 1;
+
+    if (m_texture_slots != NO_TEXTURE_SLOTS) {
+        TextureSlots& slots = m_drawlist.texture_slots[m_texture_slots];
+        for (uint8_t slot = 0; slot < slots.count; ++slot) {
+            if (slots.textures[slot] == texture)
+                return slot;
+        }
+        // Adding to the current set is fine, even if earlier calls use it
+        if (slots.count < max_slots && slots.premultiplied == premultiplied) {
+            slots.textures[slots.count] = texture;
+            return slots.count++;
+        }
     }
 
-    for (uint32_t index : rect_indices)
+    // Start a new set, which also starts a new call
+    assert(m_drawlist.texture_slots.size() < NO_TEXTURE_SLOTS && "Too many texture sets in one draw list");
+    m_texture_slots = (ResourceHandle)m_drawlist.texture_slots.size();
+    TextureSlots& slots = m_drawlist.texture_slots.emplace_back();
+    slots.textures[0] = texture;
+    slots.count = 1;
+    slots.premultiplied = premultiplied;
+    return 0;
+}
+
+void Draw::AddQuadCall(uint32_t num_quads) {
+    if (num_quads == 0)
+        return;
+
+    DrawCall* call = GetDrawCall();
+    if (call->quad_count == 0)
+        call->quad_offset = m_drawlist.quads.size() - num_quads;
+    assert(call->quad_offset + call->quad_count + num_quads == m_drawlist.quads.size() && "Quads must be contiguous within a call");
+    call->quad_count += num_quads;
+}
+
+void Draw::RectUv(glm::vec2 xy, glm::vec2 size, glm::vec2 uv, glm::vec2 uv_wh) {
+    Index index_off = ReserveVertices(rect_wh.size());
+    
+    for (const glm::vec2& wh : rect_wh)
+        PushVertex(xy + size * wh, uv + uv_wh * wh);
+
+    for (Index index : rect_indices)
         m_drawlist.indices.push_back(index + index_off);
 }
 
@@ -253,8 +659,10 @@ void Draw::EllipseUv(uint32_t num_points, glm::vec2 xy, glm::vec2 size, glm::vec
     assert(num_points >= 3 && "Ellipse must have 3 or more points");
     if (num_points < 3)
         return;
+    assert(num_points <= MAX_CHUNK_VERTICES && "Ellipse has too many points");
+    num_points = std::min(num_points, MAX_CHUNK_VERTICES);
 
-    uint32_t index_off = m_drawlist.vertices.size();
+    Index index_off = ReserveVertices(num_points);
     glm::vec2 radii = size / 2.f;
     glm::vec2 uv_radii = uv_wh / 2.f;
     glm::vec2 centered_offset = xy + radii;
@@ -266,24 +674,282 @@ void Draw::EllipseUv(uint32_t num_points, glm::vec2 xy, glm::vec2 size, glm::vec
         glm::vec2 point = radii * rotate + centered_offset;
         glm::vec2 uv_point = uv_radii * rotate + uv_centered_offset;
         
-        PushVertex(Vertex{
-            point.x, point.y,
-            uv_point.x, uv_point.y,
-            m_rgba.r, m_rgba.g, m_rgba.b, m_rgba.a
-        });
+        PushVertex(point, uv_point);
     }
     
-    for (uint32_t index = 1; index < num_points - 1; ++index)
-        m_drawlist.indices.insert(m_drawlist.indices.end(), { 0 + index_off, index + index_off, index + index_off + 1 });
+    for (uint32_t index = 1; index < num_points - 1; ++index) {
+        m_drawlist.indices.insert(m_drawlist.indices.end(), {
+            index_off, (Index)(index + index_off), (Index)(index + index_off + 1)
+        });
+    }
+}
+
+void Draw::ShapeUv(const Quad& quad) {
+    static constexpr uint32_t CORNER_POINTS = 8;
+    static constexpr uint32_t NUM_POINTS = CORNER_POINTS * 4;
+    const glm::vec2 size = glm::vec2(quad.w, quad.h);
+    if (size.x == 0 || size.y == 0)
+        return;
+
+    const glm::vec2 center = glm::vec2(quad.x, quad.y) + size / 2.f;
+    const float radius = quad.radius / SHAPE_UNITS_PER_PIXEL;
+    const float border = quad.border / SHAPE_UNITS_PER_PIXEL;
+    // Soft edges aren't blurred here, but the shape keeps its size
+    const glm::vec2 extent = glm::max(glm::abs(size) / 2.f - quad.softness / SHAPE_UNITS_PER_PIXEL, glm::vec2(0));
+
+    // Get a point on the shape's edge, relative to its center
+    auto edge_point = [&](uint32_t p, glm::vec2 extent, float radius) {
+        if (quad.shape == (uint8_t)QuadShape::ELLIPSE) {
+            float angle = 2.f * glm::pi<float>() * p / NUM_POINTS;
+            return extent * glm::vec2(glm::cos(angle), glm::sin(angle));
+        }
+        // Each corner's arc covers a quarter turn, in the same direction as the ellipse
+        radius = glm::min(radius, glm::min(extent.x, extent.y));
+        uint32_t corner = p / CORNER_POINTS;
+        float angle = glm::pi<float>() / 2.f * (corner + (p % CORNER_POINTS) / (float)(CORNER_POINTS - 1));
+        glm::vec2 sign = glm::vec2(corner == 0 || corner == 3 ? 1 : -1, corner < 2 ? 1 : -1);
+        return sign * (extent - radius) + radius * glm::vec2(glm::cos(angle), glm::sin(angle));
+    };
+    auto push_vertex = [&](glm::vec2 offset) {
+        glm::vec2 pos = center + offset;
+        glm::vec2 t = offset / size + 0.5f;
+        m_drawlist.vertices.emplace_back(Vertex{
+            pos.x, pos.y,
+            (uint16_t)(quad.u0 + (quad.u1 - quad.u0) * t.x + 0.5f),
+            (uint16_t)(quad.v0 + (quad.v1 - quad.v0) * t.y + 0.5f),
+            quad.r, quad.g, quad.b, quad.a
+        });
+    };
+
+    if (border <= 0) {
+        // Fan around the center
+        Index index_off = ReserveVertices(NUM_POINTS + 1);
+        push_vertex(glm::vec2(0));
+        for (uint32_t p = 0; p < NUM_POINTS; ++p)
+            push_vertex(edge_point(p, extent, radius));
+        for (uint32_t p = 0; p < NUM_POINTS; ++p) {
+            m_drawlist.indices.insert(m_drawlist.indices.end(), {
+                index_off, (Index)(index_off + 1 + p), (Index)(index_off + 1 + (p + 1) % NUM_POINTS)
+            });
+        }
+        return;
+    }
+
+    // Ring between the outer and inner edges, as pairs of outer and inner points
+    const glm::vec2 inner_extent = glm::max(extent - border, glm::vec2(0));
+    const float inner_radius = glm::max(radius - border, 0.f);
+    Index index_off = ReserveVertices(NUM_POINTS * 2);
+    for (uint32_t p = 0; p < NUM_POINTS; ++p) {
+        push_vertex(edge_point(p, extent, radius));
+        push_vertex(edge_point(p, inner_extent, inner_radius));
+    }
+    for (uint32_t p = 0; p < NUM_POINTS; ++p) {
+        Index outer = index_off + p * 2, inner = outer + 1;
+        Index next_outer = index_off + (p + 1) % NUM_POINTS * 2, next_inner = next_outer + 1;
+        m_drawlist.indices.insert(m_drawlist.indices.end(), {
+            outer, next_outer, inner,
+            inner, next_outer, next_inner
+        });
+    }
+}
+
+void Draw::StrokeInternal(float thickness, bool closed) {
+    std::vector<glm::vec2>& points = m_stroke_points;
+    // Repeated points have no direction
+    points.erase(std::unique(points.begin(), points.end()), points.end());
+    if (closed && points.size() > 2 && points.front() == points.back())
+        points.pop_back();
+    if (points.size() < 2 || !(thickness > 0))
+        return;
+
+    // Lines thinner than a pixel fade out instead
+    std::array<uint8_t, 4> color = m_color;
+    if (thickness < 1) {
+        color[3] = (uint8_t)(color[3] * thickness + 0.5f);
+        thickness = 1;
+    }
+    const float half_width = thickness / 2;
+
+    glm::vec2 min = points[0], max = points[0];
+    for (const glm::vec2& point : points) {
+        min = glm::min(min, point);
+        max = glm::max(max, point);
+    }
+    if (IsHidden(min - half_width - 1.f, max + half_width + 1.f))
+        return;
+
+    SetTexture(nullptr);
+    const size_t num_points = points.size();
+    const size_t num_segments = closed ? num_points : num_points - 1;
+    auto normal = [&](size_t segment) {
+        glm::vec2 dir = glm::normalize(points[(segment + 1) % num_points] - points[segment]);
+        return glm::vec2(-dir.y, dir.x);
+    };
+
+    // Each point has 4 vertices across the line: A transparent edge, two solid edges, and another transparent edge.
+    // Long lines are split into pieces that fit in a vertex chunk, where each piece repeats the last point of the previous one.
+    const size_t max_piece_segments = MAX_CHUNK_VERTICES / 4 - 1;
+    for (size_t begin = 0; begin < num_segments; begin += max_piece_segments) {
+        const size_t end = std::min(begin + max_piece_segments, num_segments);
+        const Index index_off = ReserveVertices((end - begin + 1) * 4);
+        const size_t first_index = m_drawlist.indices.size();
+        m_drawlist.vertices.resize(m_drawlist.vertices.size() + (end - begin + 1) * 4);
+        m_drawlist.indices.resize(first_index + (end - begin) * 18);
+        Vertex* vertex = &*(m_drawlist.vertices.end() - (end - begin + 1) * 4);
+        Index* index = &m_drawlist.indices[first_index];
+
+        glm::vec2 prev_normal = (closed || begin > 0) ? normal((begin + num_points - 1) % num_points) : glm::vec2(0);
+        for (size_t i = begin; i <= end; ++i) {
+            const bool has_prev = closed || i > 0;
+            const bool has_next = closed || i < num_points - 1;
+            const glm::vec2 next_normal = has_next ? normal(i % num_points) : prev_normal;
+            glm::vec2 offset = next_normal;
+            if (has_prev && has_next) {
+                // Miter between both segments, limited so sharp corners don't spike
+                glm::vec2 miter = prev_normal + next_normal;
+                if (glm::dot(miter, miter) > 1e-6f) {
+                    miter = glm::normalize(miter);
+                    offset = miter / glm::max(glm::dot(miter, next_normal), MIN_MITER_DOT);
+                }
+            }
+            prev_normal = next_normal;
+
+            const glm::vec2 point = points[i % num_points];
+            const float widths[4] = { -half_width - 1, -half_width, half_width, half_width + 1 };
+            for (int v = 0; v < 4; ++v) {
+                glm::vec2 pos = point + offset * widths[v];
+                uint8_t alpha = (v == 0 || v == 3) ? 0 : color[3];
+                *vertex++ = Vertex{ pos.x, pos.y, 0, 0, color[0], color[1], color[2], alpha };
+            }
+        }
+
+        for (size_t s = 0; s < end - begin; ++s) {
+            Index a = index_off + (Index)(s * 4), b = a + 4;
+            for (Index v = 0; v < 3; ++v) {
+                *index++ = a + v; *index++ = b + v; *index++ = b + v + 1;
+                *index++ = a + v; *index++ = b + v + 1; *index++ = a + v + 1;
+            }
+        }
+        AddDrawCall(m_drawlist.indices.size() - first_index);
+    }
+}
+
+float Draw::GetTransformScale() const {
+    if (m_transforms.empty())
+        return 1;
+    const glm::mat3& tform = m_transforms.back();
+    return glm::sqrt(glm::abs(tform[0][0] * tform[1][1] - tform[0][1] * tform[1][0]));
+}
+
+void Draw::ApplyTransform(size_t first_vertex) {
+    if (m_transforms.empty() || first_vertex >= m_drawlist.vertices.size())
+        return;
+    Vertex* first = &m_drawlist.vertices[first_vertex];
+    TransformPoints(&first->x, m_drawlist.vertices.size() - first_vertex, sizeof(Vertex), m_transforms.back());
+}
+
+Index Draw::ReserveVertices(uint32_t num_vertices) {
+    assert(num_vertices <= MAX_CHUNK_VERTICES);
+    uint32_t chunk_size = m_drawlist.vertices.size() - m_vertex_base;
+    if (chunk_size + num_vertices > MAX_CHUNK_VERTICES) {
+        // Start a new chunk, which also starts a new call
+        m_vertex_base = m_drawlist.vertices.size();
+        m_dirty_params = true;
+        chunk_size = 0;
+    }
+    return (Index)chunk_size;
+}
+
+glm::vec4 Draw::TransformClip(const glm::vec4& clip, const glm::mat3& tform) {
+    glm::vec2 min = glm::vec2(INFINITY), max = glm::vec2(-INFINITY);
+    for (const glm::vec2& wh : rect_wh) {
+        glm::vec2 corner = glm::vec2(tform * glm::vec3(clip.x + clip.z * wh.x, clip.y + clip.w * wh.y, 1));
+        min = glm::min(min, corner);
+        max = glm::max(max, corner);
+    }
+    return glm::vec4(min, max - min);
+}
+
+glm::vec4 Draw::ClampClip(glm::vec4 clip, const glm::vec4& bounds) {
+    // Clamp `clip` within the boundaries of `bounds`
+    // using { x0,y0, x1,y1 } format
+    glm::vec4 old_corners = glm::vec4(
+        bounds[0], bounds[1],
+        bounds[0] + bounds[2], bounds[1] + bounds[3]
+    );
+    glm::vec4 new_corners = glm::vec4(clip[0], clip[1], clip[0] + clip[2], clip[1] + clip[3]);
+
+    // Top-left
+    for (uint8_t tl = 0; tl < 2; ++tl) {
+        if (new_corners[tl] < old_corners[tl])
+            new_corners[tl] = old_corners[tl];
+    }
+
+    // Bottom-right
+    for (uint8_t br = 2; br < 4; ++br) {
+        if (new_corners[br] > old_corners[br])
+            new_corners[br] = old_corners[br];
+    }
+
+    // Use { x, y, w, h } format again
+    clip = new_corners;
+    clip[2] -= clip[0];
+    clip[3] -= clip[1];
+    return clip;
+}
+
+void Draw::TintColor(uint8_t* rgba, const std::array<uint8_t, 4>& tint) {
+    for (int i = 0; i < 4; ++i)
+        rgba[i] = (uint8_t)((rgba[i] * tint[i] + 127) / 255);
 }
 
 glm::vec2 Draw::VecOrDefault(glm::vec2 value, glm::vec2 default_value) {
     return glm::isnan(value.x) ? default_value : value;
 }
 
-void Draw::SetTexture(TexturePtr texture) {
-    m_dirty_params = true;
-    m_params.texture = texture;
+void Draw::SetTexture(const TexturePtr& texture) {
+    ResourceHandle handle = GetHandle(m_drawlist.textures, m_texture_handles, texture);
+    if (handle == m_texture)
+        return;
+    m_texture = handle;
+    m_texel_scale = glm::vec2(0);
+    if (texture != nullptr)
+        m_texel_scale = 1.f / glm::vec2(texture->GetInfo().width, texture->GetInfo().height);
+}
+
+template <class T>
+ResourceHandle Draw::GetHandle(
+    std::vector<std::shared_ptr<T>>& table,
+    std::unordered_map<const T*, ResourceHandle>& handles,
+    const std::shared_ptr<T>& resource
+) {
+    if (resource == nullptr)
+        return DEFAULT_HANDLE;
+
+    auto it = handles.find(resource.get());
+    if (it != handles.end())
+        return it->second;
+
+    assert(table.size() <= UINT16_MAX && "Too many resources in one draw list");
+    ResourceHandle handle = (ResourceHandle)table.size();
+    table.emplace_back(resource);
+    handles.emplace(resource.get(), handle);
+    return handle;
+}
+
+ResourceHandle Draw::GetClipHandle(const glm::vec4& clip) {
+    if (glm::isnan(clip.x))
+        return DEFAULT_HANDLE;
+
+    auto it = m_clip_handles.find(clip);
+    if (it != m_clip_handles.end())
+        return it->second;
+
+    assert(m_drawlist.clips.size() <= UINT16_MAX && "Too many clip rects in one draw list");
+    ResourceHandle handle = (ResourceHandle)m_drawlist.clips.size();
+    m_drawlist.clips.emplace_back(clip);
+    m_clip_handles.emplace(clip, handle);
+    return handle;
 }
 
 void Draw::AddDrawCall(uint32_t num_indices) {
@@ -293,6 +959,7 @@ void Draw::AddDrawCall(uint32_t num_indices) {
     assert((num_indices % 3 == 0) && "num_indices must be a multiple of 3 to create triangles");
     assert(num_indices <= m_drawlist.indices.size() && "num_indices is greater than the total available indices");
     
+    SetCallParams(Primitive::TRIANGLES, m_texture, m_clip);
     DrawCall* call = GetDrawCall();
 
     if (call->index_count == 0)
@@ -306,18 +973,27 @@ void Draw::AddDrawCall(uint32_t num_indices) {
     call->index_count += num_indices;
 }
 
+void Draw::SetCallParams(Primitive primitive, ResourceHandle texture, ResourceHandle clip) {
+    if (primitive == m_params.primitive && texture == m_params.texture && clip == m_params.clip)
+        return;
+    m_dirty_params = true;
+    m_params.primitive = primitive;
+    m_params.texture = texture;
+    m_params.clip = clip;
+}
+
 DrawCall* Draw::GetDrawCall() {
     if (m_drawlist.calls.empty()) {
         // Start a new call
-        m_drawlist.calls.emplace_back(uint32_t{0}, uint32_t{0}, uint32_t{0}, (uint32_t)m_drawlist.shader_params.items.size(), m_params);
+        m_drawlist.calls.emplace_back(uint32_t{0}, uint32_t{0}, m_vertex_base, uint32_t{0}, m_drawlist.shader_params.Size(), m_params);
         m_dirty_params = false;
     } else if (m_dirty_params) {
         DrawCall& last = m_drawlist.calls.back();
-        uint32_t sp_offset = last.sp_offset + last.sp_count;
-        // Number of shader params added since last call
-        uint32_t sp_count = (uint32_t)m_drawlist.shader_params.items.size() - sp_offset;
-        if (last.params != m_params || sp_count > 0)
-            m_drawlist.calls.emplace_back(uint32_t{0}, uint32_t{0}, sp_offset, sp_count, m_params);
+        uint32_t sp_offset = last.sp_offset + last.sp_size;
+        // Size of the shader params added since last call
+        uint32_t sp_size = m_drawlist.shader_params.Size() - sp_offset;
+        if (last.params != m_params || sp_size > 0 || last.vertex_offset != m_vertex_base)
+            m_drawlist.calls.emplace_back(uint32_t{0}, uint32_t{0}, m_vertex_base, sp_offset, sp_size, m_params);
         m_dirty_params = false;
     }
     return &m_drawlist.calls.back();
@@ -3,10 +3,15 @@
 #include "font/forward.hpp"
 #include "render2d_list.hpp"
 #include "opengl/oglshader.hpp"
+#include <util/parallel.hpp>
+#include <fnv1a.hpp>
 #include <cmath> // NAN
 #include <vector>
+#include <array>
 #include <memory>
+#include <unordered_map>
 #include <string_view>
+#include <span>
 #include <glm/vec2.hpp>
 #include <glm/vec4.hpp>
 #include <glm/mat3x3.hpp>
@@ -27,16 +32,43 @@ public:
     void Clear();
     Render2d::DrawList& GetDrawList() { return m_drawlist; }
     const Render2d::DrawList& GetDrawList() const { return m_drawlist; }
-    void SetProgram(OglProgramPtr program = nullptr);
+    void SetProgram(const OglProgramPtr& program = nullptr);
+    /**
+     * @brief Draw rects and glyphs as instanced quads, instead of indexed triangles.
+     * Quads are only used with the default program and an axis-aligned transform. Otherwise, triangles are used.
+     */
+    void SetInstancedQuads(bool enable) { m_instanced_quads = enable; }
+    bool GetInstancedQuads() const { return m_instanced_quads; }
+    /**
+     * @brief Let quads with different textures share a call, using up to @ref MAX_TEXTURE_SLOTS textures at once.
+     * Otherwise, every texture change starts a new call.
+     */
+    void SetTextureBatching(bool enable) { m_texture_batching = enable; }
+    bool GetTextureBatching() const { return m_texture_batching; }
+    /**
+     * @brief Clip quads against the clip rect on the CPU, instead of with a scissor.
+     * Hidden quads are dropped, partially visible quads are trimmed along with their texture coords,
+     * and the remaining quads batch across clip rects.
+     * Other geometry is dropped when it's fully hidden, but is otherwise still clipped with a scissor.
+     * Without a clip rect, geometry outside the screen (@ref m_screen_w by @ref m_screen_h) is dropped, so the draw must be in screen space.
+     */
+    void SetCpuClipping(bool enable) { m_cpu_clipping = enable; }
+    bool GetCpuClipping() const { return m_cpu_clipping; }
     // Tip: Don't use this in a loop where it assigns the same value every time. This kills batching.
+    /** Set a uniform of the current program. Values that don't match the uniform's type are dropped with a warning. */
     template <class T>
     void SetShaderParam(std::string_view name, const T& value) {
-        if (m_params.program != nullptr)
-            m_drawlist.shader_params.Set(m_params.program->GetUniformLocation(name), value);
+        const OglProgramPtr& program = m_drawlist.programs[m_params.program];
+        if (program == nullptr)
+            return;
+        GLint location = program->GetUniformLocationFor<T>(name);
+        // A repeated value is dropped, so it doesn't start a new call
+        if (location != -1 && m_drawlist.shader_params.Set(m_params.program, location, value))
+            m_dirty_params = true;
     }
     void SetColor(const glm::vec4& rgba);
     void SetColor(float r, float g, float b, float a = 1.f) { SetColor(glm::vec4(r,g,b,a)); }
-    void ResetColor() { m_rgba = glm::vec4(1); }
+    void ResetColor() { SetColor(glm::vec4(1)); }
     /**
      * @brief Set a new clip rect, wich is further clipped within the bounds of the previous rect.
      * @param new_clip Rectangle in `{ x, y, w, h }` format.
@@ -59,7 +91,7 @@ public:
      * @param size Rectangle size. The default value will use the texture's size.
      *  If `texture` is `nullptr`, nothing will be drawn.
      */
-    void TextureRect(TexturePtr texture, glm::vec2 top_left, glm::vec2 size = glm::vec2(NAN));
+    void TextureRect(const TexturePtr& texture, glm::vec2 top_left, glm::vec2 size = glm::vec2(NAN));
     void Ellipse(uint32_t num_points, glm::vec2 top_left, glm::vec2 size);
     void Ellipse(uint32_t num_points, float x, float y, float w, float h) { Ellipse(num_points, glm::vec2(x, y), glm::vec2(w, h)); }
     /**
@@ -67,7 +99,71 @@ public:
      * @param size Ellipse size. The default value will use the texture's size.
      *  If `texture` is `nullptr`, nothing will be drawn.
      */
-    void TextureEllipse(TexturePtr texture, uint32_t num_points, glm::vec2 top_left, glm::vec2 size = glm::vec2(NAN));
+    void TextureEllipse(const TexturePtr& texture, uint32_t num_points, glm::vec2 top_left, glm::vec2 size = glm::vec2(NAN));
+    /**
+     * @brief Draw an anti-aliased ellipse as a single quad.
+     * With the default program and an axis-aligned transform, this batches with rects. Otherwise, it's tessellated.
+     */
+    void Ellipse(glm::vec2 top_left, glm::vec2 size);
+    void Ellipse(float x, float y, float w, float h) { Ellipse(glm::vec2(x, y), glm::vec2(w, h)); }
+    /** @param thickness Width of the outline, inside the ellipse's edge. See @ref Ellipse. */
+    void EllipseOutline(glm::vec2 top_left, glm::vec2 size, float thickness);
+    /** Draw an anti-aliased rect with rounded corners. See @ref Ellipse. */
+    void RoundedRect(glm::vec2 top_left, glm::vec2 size, float radius);
+    void RoundedRect(float x, float y, float w, float h, float radius) { RoundedRect(glm::vec2(x, y), glm::vec2(w, h), radius); }
+    /**
+     * @brief Draw an anti-aliased rect outline. See @ref Ellipse.
+     * @param thickness Width of the outline, inside the rect's edge
+     * @param radius Radius of the rounded corners
+     */
+    void RectOutline(glm::vec2 top_left, glm::vec2 size, float thickness, float radius = 0);
+    /**
+     * @brief Draw a soft shadow of a rounded rect. See @ref Ellipse.
+     * @param softness Distance that the shadow fades over, centered on the rect's edge
+     * @param radius Radius of the rounded corners
+     */
+    void Shadow(glm::vec2 top_left, glm::vec2 size, float softness, float radius = 0);
+    /**
+     * @brief Draw connected line segments with mitered joins and anti-aliased edges.
+     * Lines are tessellated after the transform, and skipped if they're outside the clip rect.
+     * @param thickness Line width, which is scaled with the transform.
+     *  Lines thinner than a pixel are drawn one pixel wide, and fade out instead.
+     * @param closed Also connect the last point to the first
+     */
+    void Polyline(std::span<const glm::vec2> points, float thickness, bool closed = false);
+    /**
+     * @brief Draw a cubic Bézier curve as a polyline. See @ref Polyline.
+     * It's subdivided based on its size after the transform, so it stays smooth at any zoom.
+     * @param p0 Start point
+     * @param p1 First control point
+     * @param p2 Second control point
+     * @param p3 End point
+     */
+    void Bezier(glm::vec2 p0, glm::vec2 p1, glm::vec2 p2, glm::vec2 p3, float thickness);
+    /**
+     * @brief Append every call of another draw list, without re-tessellating it.
+     * The geometry is transformed by the current transform and clipped within the current clip rect.
+     * The list's own clip rects are transformed too, to the axis-aligned bounds of each transformed rect.
+     * @param tint Multiplied with the color of each vertex and quad
+     */
+    void Append(const DrawList& list, const glm::vec4& tint = glm::vec4(1));
+    /** Append a recorded fragment. See @ref Append. */
+    void AppendFragment(const DrawFragment& fragment, const glm::vec4& tint = glm::vec4(1));
+    /**
+     * @brief Build several draws on worker threads, then append them in order. See @ref Append.
+     * The result is the same as building each draw on this thread, one after another.
+     * @param draws One draw per piece of work. Each is cleared before it's built, and may be reused across frames.
+     * @param build Called as `build(index, draws[index])` on any thread. It must not modify shared state.
+     */
+    template <class Fn>
+    void AppendParallel(std::vector<Draw>& draws, Fn&& build) {
+        ParallelFor(draws.size(), [&](size_t index) {
+            draws[index].Clear();
+            build(index, draws[index]);
+        });
+        for (const Draw& draw : draws)
+            Append(draw.GetDrawList());
+    }
     inline void PushTransform(glm::mat3 tform) {
         if (!m_transforms.empty())
             tform = m_transforms.back() * tform;
@@ -78,38 +174,180 @@ public:
             m_transforms.pop_back();
     }
 private:
-    inline void PushVertex(Vertex v) {
-        glm::vec3 vec{v.x, v.y, 1.f};
-        if (!m_transforms.empty())
-            vec = m_transforms.back() * vec;
-        v.x = vec.x, v.y = vec.y;
-        m_drawlist.vertices.emplace_back(v);
+    /**
+     * @brief Add an untransformed vertex. Call @ref ApplyTransform once the primitive is complete.
+     * @param pos Position in pixels
+     * @param uv Texture coords in texels of the current texture
+     */
+    inline void PushVertex(glm::vec2 pos, glm::vec2 uv) {
+        uv *= m_texel_scale;
+        m_drawlist.vertices.emplace_back(Vertex{
+            pos.x, pos.y,
+            PackUnorm16(uv.x), PackUnorm16(uv.y),
+            m_color[0], m_color[1], m_color[2], m_color[3]
+        });
     }
+    /**
+     * @brief Apply the current transform to every vertex added since `first_vertex`, in bulk.
+     * @param first_vertex Size of the vertex buffer before the primitive(s) were added
+     */
+    void ApplyTransform(size_t first_vertex);
+    /**
+     * @brief Make room for a primitive's vertices in the current chunk, or start a new chunk.
+     * @param num_vertices Number of vertices about to be pushed. Must not exceed @ref MAX_CHUNK_VERTICES.
+     * @return The index of the next pushed vertex, relative to the current chunk
+     */
+    Index ReserveVertices(uint32_t num_vertices);
     void TextInternal(FontHandle font, glm::vec2 top_left, const void* begin, const void* end, uint8_t stride);
+    /**
+     * @brief Add a rectangle and its draw call, as a quad or as triangles.
+     * Call @ref ApplyTransform afterwards, in case triangles were used.
+     * @param uv Texture coords in texels of the current texture
+     */
+    void AddRect(glm::vec2 xy, glm::vec2 size, glm::vec2 uv, glm::vec2 uv_wh);
     /** Internal utility to add rectangle geometry */
     void RectUv(glm::vec2 xy, glm::vec2 size, glm::vec2 uv, glm::vec2 uv_wh);
+    /** @return `true` if the next rect can be drawn as a @ref Quad */
+    bool CanUseQuads() const;
+    /** Internal utility to add an already-transformed quad and its draw call */
+    void AddQuad(glm::vec2 xy, glm::vec2 size, glm::vec2 uv, glm::vec2 uv_wh);
+    /**
+     * @brief Add an untextured shape and its draw call, as a quad or as triangles
+     * @param radius Corner radius in pixels
+     * @param border Outline width in pixels, or `0` to fill the shape
+     * @param softness Edge blur in pixels. The shape is inset from `xy` and `size` by this distance.
+     */
+    void AddShape(QuadShape shape, glm::vec2 xy, glm::vec2 size, float radius, float border, float softness);
+    /** Apply an axis-aligned transform to a quad, including its shape's distances */
+    static void TransformQuad(Quad& quad, const glm::mat3& tform);
+    /** Internal utility to tessellate a quad's shape into untransformed triangles. Soft edges are drawn sharp. */
+    void ShapeUv(const Quad& quad);
+    /** Add a finished quad and its draw call. Its slot is assigned from `texture`. */
+    void PushQuad(Quad quad, ResourceHandle texture);
+    /**
+     * @brief Trim a quad and its texture coords to fit within a clip rect
+     * @param clip Rectangle in `{ x, y, w, h }` format
+     * @return `false` if the quad is completely hidden
+     */
+    static bool ClipQuad(Quad& quad, const glm::vec4& clip);
+    /**
+     * @brief Stroke the points in `m_stroke_points`, which are already transformed. See @ref Polyline.
+     * @param thickness Line width in pixels
+     */
+    void StrokeInternal(float thickness, bool closed);
+    /** @return The factor that the current transform scales lengths by, on average */
+    float GetTransformScale() const;
+    /**
+     * @brief Check if transformed bounds are entirely outside the current clip rect.
+     * With CPU clipping and no clip rect, the screen is used instead.
+     * This is always `false` with user programs, which may not use pixel coordinates.
+     */
+    bool IsHidden(glm::vec2 min, glm::vec2 max) const;
+    /**
+     * @brief Remove a finished primitive if CPU clipping is enabled and the clip rect hides all of it
+     * @param first_vertex Size of the vertex buffer before the primitive was added
+     * @param first_index Size of the index buffer before the primitive was added
+     * @return `true` if the primitive was removed
+     */
+    bool CullTriangles(size_t first_vertex, size_t first_index);
+    /**
+     * @brief Find or add a texture in the current @ref TextureSlots, or start a new set when it's full
+     * @param texture Handle into the draw list's textures
+     * @return The texture's slot
+     */
+    uint8_t GetTextureSlot(ResourceHandle texture);
+    /**
+     * @brief Append the quads of another list's call, as quads or as untransformed triangles
+     * @param textures Map of the list's texture handles to our own
+     */
+    void AppendQuads(const DrawList& list, const DrawCall& call, const std::vector<ResourceHandle>& textures, const std::array<uint8_t, 4>& tint);
+    /** Append the triangles of another list's call, with untransformed vertices */
+    void AppendTriangles(const DrawList& list, const DrawCall& call);
+    /**
+     * @brief Add a draw call for the last number of quads, `num_quads`.
+     * In most cases, it's appended to a previous draw call with the same parameters.
+     * Call @ref SetCallParams first.
+     */
+    void AddQuadCall(uint32_t num_quads);
     /** Internal utility to add ellipse geometry */
     void EllipseUv(uint32_t num_points, glm::vec2 xy, glm::vec2 size, glm::vec2 uv, glm::vec2 uv_wh);
 
+    /**
+     * @brief Clamp a clip rect within the bounds of another. Neither may be @ref NO_CLIP.
+     * @param clip Rectangle in `{ x, y, w, h }` format
+     * @param bounds Rectangle in `{ x, y, w, h }` format
+     */
+    static glm::vec4 ClampClip(glm::vec4 clip, const glm::vec4& bounds);
+    /**
+     * @brief Transform a clip rect, which may not be @ref NO_CLIP
+     * @return The axis-aligned bounds of the transformed rect, in `{ x, y, w, h }` format
+     */
+    static glm::vec4 TransformClip(const glm::vec4& clip, const glm::mat3& tform);
+    /** Multiply each color channel by `tint`, in unorm8 */
+    static void TintColor(uint8_t* rgba, const std::array<uint8_t, 4>& tint);
     /** @return `value` if `value` is not NaN. Otherwise, `default_value` */
     static glm::vec2 VecOrDefault(glm::vec2 value, glm::vec2 default_value); 
-    void SetTexture(TexturePtr texture);
+    void SetTexture(const TexturePtr& texture);
+    /**
+     * @brief Find or add a resource in one of the draw list's tables
+     * @param table One of the draw list's resource tables
+     * @param handles Map of each resource in `table` to its handle
+     */
+    template <class T>
+    static ResourceHandle GetHandle(
+        std::vector<std::shared_ptr<T>>& table,
+        std::unordered_map<const T*, ResourceHandle>& handles,
+        const std::shared_ptr<T>& resource
+    );
+    ResourceHandle GetClipHandle(const glm::vec4& clip);
     /**
      * @brief Add a new draw call that draws the last number of indices, `num_indices`, with the current clipping rect and texture.
      * In most cases, it's appended to a previous draw call with the same parameters.
      * @param num_indices The number of new vertices added. Must be a multiple of 3.
      */
     void AddDrawCall(uint32_t num_indices);
+    /**
+     * @brief Set the primitive, texture, and clip rect of the next draw call, which splits the call if any changed
+     * @param texture Handle into the draw list's textures, or its texture slots for @ref Primitive::QUADS
+     * @param clip Handle into the draw list's clips. Use @ref DEFAULT_HANDLE for geometry that was clipped on the CPU.
+     */
+    void SetCallParams(Primitive primitive, ResourceHandle texture, ResourceHandle clip);
     /// @brief Get or create a draw call with the same params as `m_params`. This is always the last call.
     Render2d::DrawCall* GetDrawCall();
 
-    glm::vec4 m_rgba = glm::vec4(1);
+    /// @brief Current color, already packed for @ref Vertex
+    std::array<uint8_t, 4> m_color = { 255, 255, 255, 255 };
+    /// @brief Converts texels of the current texture to normalized coords
+    glm::vec2 m_texel_scale = glm::vec2(0);
     DrawList m_drawlist;
-    std::vector<glm::vec4> m_clip_stack;
+    std::vector<ResourceHandle> m_clip_stack;
     std::vector<glm::mat3> m_transforms;
+    /// @brief Reused buffer of transformed points for @ref StrokeInternal
+    std::vector<glm::vec2> m_stroke_points;
+    /// @brief Reused map from a source vertex to its new index, for @ref AppendTriangles
+    std::vector<uint32_t> m_vertex_remap;
     DrawCallParams m_params;
+    /// @brief Current texture. This is only copied to `m_params` once a call uses it.
+    ResourceHandle m_texture = DEFAULT_HANDLE;
+    /// @brief Current clip rect. This is only copied to `m_params` once a call uses it.
+    ResourceHandle m_clip = DEFAULT_HANDLE;
+    /// @brief Index of the current set in the draw list's texture slots, or @ref NO_TEXTURE_SLOTS
+    ResourceHandle m_texture_slots = NO_TEXTURE_SLOTS;
+    static constexpr ResourceHandle NO_TEXTURE_SLOTS = UINT16_MAX;
+    // Handles of every resource in `m_drawlist`, so each resource is only added once
+    std::unordered_map<const Texture*, ResourceHandle> m_texture_handles;
+    std::unordered_map<const OglProgram*, ResourceHandle> m_program_handles;
+    struct ClipHash {
+        size_t operator()(const glm::vec4& clip) const { return fnv1a::Hash_32(clip); }
+    };
+    std::unordered_map<glm::vec4, ResourceHandle, ClipHash> m_clip_handles;
+    /// @brief First vertex of the current chunk
+    uint32_t m_vertex_base = 0;
     // True if `m_params` has been modified since the last-created call
     bool m_dirty_params = false;
+    bool m_instanced_quads = true;
+    bool m_texture_batching = true;
+    bool m_cpu_clipping = false;
 };
 
 }
\ No newline at end of file
@@ -0,0 +1,40 @@
+#pragma once
+#include "render2d_draw.hpp"
+#include <cstdint>
+
+namespace Render2d {
+
+/**
+ * @brief Geometry that is recorded once, then appended into other draws any number of times.
+ * Appending copies the recorded vertices, indices, quads, and calls without re-tessellating them.
+ * @see Draw::AppendFragment
+ */
+class DrawFragment {
+public:
+    /**
+     * @param source_key Identifies the source that the geometry was recorded from, such as a hash of its contents
+     * @return `true` if the fragment was last recorded from the same source
+     */
+    bool IsCurrent(uint64_t source_key) const { return m_is_recorded && m_source_key == source_key; }
+    /**
+     * @brief Clear the fragment and begin recording it from a new source.
+     * Geometry is recorded in the fragment's local coordinates.
+     * @return The draw to record with. It stays valid until the fragment is destroyed.
+     */
+    Draw& Record(uint64_t source_key) {
+        m_draw.Clear();
+        m_source_key = source_key;
+        m_is_recorded = true;
+        return m_draw;
+    }
+    /** Force the next call to @ref IsCurrent to fail */
+    void Invalidate() { m_is_recorded = false; }
+    const DrawList& GetDrawList() const { return m_draw.GetDrawList(); }
+
+private:
+    Draw m_draw;
+    uint64_t m_source_key = 0;
+    bool m_is_recorded = false;
+};
+
+}
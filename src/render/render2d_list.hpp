@@ -1,6 +1,12 @@
 #pragma once
 #include <vector>
+#include <cassert>
+#include <array>
 #include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <bit>
+#include <unordered_map>
 #include <glm/vec4.hpp>
 #include <glm/mat4x4.hpp>
 #include <glm/glm.hpp>
@@ -11,6 +17,10 @@
 
 namespace Render2d {
     static const glm::vec4 NO_CLIP = glm::vec4(NAN);
+    /// @brief Index type of a @ref DrawList. Indices are relative to their call's `vertex_offset`.
+    using Index = uint16_t;
+    /// @brief Maximum number of vertices that a single @ref Index can address
+    static constexpr uint32_t MAX_CHUNK_VERTICES = 1 << (sizeof(Index) * 8);
     template <class>
     constexpr bool _dependent_false = false;
 
@@ -25,69 +35,262 @@ namespace Render2d {
     constexpr ShaderParamType ToShaderParamType(glm::vec4*)   { return ShaderParamType::VEC4; }
     constexpr ShaderParamType ToShaderParamType(glm::mat3x3*) { return ShaderParamType::MAT3X3; }
     constexpr ShaderParamType ToShaderParamType(glm::mat4x4*) { return ShaderParamType::MAT4X4; }
+
+    /** @return Size of a shader param's value in bytes */
+    constexpr uint32_t GetShaderParamSize(ShaderParamType type) {
+        switch (type) {
+        case ShaderParamType::INT:    return sizeof(int);
+        case ShaderParamType::FLOAT:  return sizeof(float);
+        case ShaderParamType::VEC2:   return sizeof(glm::vec2);
+        case ShaderParamType::VEC3:   return sizeof(glm::vec3);
+        case ShaderParamType::VEC4:   return sizeof(glm::vec4);
+        case ShaderParamType::MAT3X3: return sizeof(glm::mat3x3);
+        case ShaderParamType::MAT4X4: return sizeof(glm::mat4x4);
+        }
+        return 0;
+    }
     
+    /**
+     * @brief A compact vertex, 16 bytes in total.
+     * Positions are in pixels, texture coords are normalized, and color is RGBA8.
+     */
     struct Vertex
     {
         float x, y;
-        float u, v;
-        float r, g, b, a;
+        /// @brief Normalized texture coords as unorm16, so within [0, 1]. Use @ref PackUnorm16.
+        uint16_t u, v;
+        /// @brief Color as unorm8. Use @ref PackColor.
+        uint8_t r, g, b, a;
+    };
+    static_assert(sizeof(Vertex) == 16, "Vertex should stay tightly packed");
+
+    /// @brief Describes one vertex attribute, in the form expected by `glVertexAttribPointer`
+    struct VertexAttrib {
+        /// @brief Name of the attribute in the vertex shader
+        const char* name;
+        GLint size;
+        GLenum type;
+        GLboolean normalized;
+        uint32_t offset;
+    };
+
+    /// @brief Layout of @ref Vertex, as seen by the default shaders and any user programs
+    static constexpr VertexAttrib VERTEX_LAYOUT[] = {
+        { "in_pos",   2, GL_FLOAT,          GL_FALSE, offsetof(Vertex, x) },
+        { "in_uv",    2, GL_UNSIGNED_SHORT, GL_TRUE,  offsetof(Vertex, u) },
+        { "in_color", 4, GL_UNSIGNED_BYTE,  GL_TRUE,  offsetof(Vertex, r) },
+    };
+
+    /// @brief Maximum number of textures that one call of quads can sample from
+    static constexpr uint32_t MAX_TEXTURE_SLOTS = 8;
+
+    /// @brief Analytic shape of a @ref Quad, which the default quad shader evaluates and anti-aliases per pixel
+    enum class QuadShape : uint8_t {
+        /// @brief The whole quad, without anti-aliasing
+        RECT,
+        /// @brief A rect with rounded corners of @ref Quad::radius
+        ROUNDED_RECT,
+        /// @brief An ellipse that touches each edge of the quad
+        ELLIPSE,
+    };
+
+    /// @brief Number of @ref Quad shape units per pixel
+    static constexpr float SHAPE_UNITS_PER_PIXEL = 16.f;
+
+    /**
+     * @brief An axis-aligned, textured rectangle, drawn as one instance of a shared unit quad.
+     * This replaces the 4 vertices and 6 indices that a rect would otherwise take.
+     * A quad may also hold a @ref QuadShape, so shapes batch with plain rects.
+     */
+    struct Quad
+    {
+        /// @brief Top-left corner and size in pixels. The size may be negative to flip the quad.
+        float x, y, w, h;
+        /// @brief Normalized texture coords of the top-left and bottom-right corners, as unorm16
+        uint16_t u0, v0, u1, v1;
+        /// @brief Color as unorm8. Use @ref PackColor.
+        uint8_t r, g, b, a;
+        /// @brief Index into the call's @ref TextureSlots
+        uint8_t slot;
+        /// @brief A @ref QuadShape
+        uint8_t shape;
+        /// @brief Corner radius of a rounded rect, in shape units. Use @ref PackShapeUnits.
+        uint16_t radius;
+        /// @brief Width of the outline within the shape's edge, or `0` to fill it. In shape units.
+        uint16_t border;
+        /// @brief Blur distance across the shape's edge, or `0` for a sharp edge. In shape units.
+        /// The shape is inset from the quad's edges by this distance, so the blur fits inside the quad.
+        uint16_t softness;
+    };
+    static_assert(sizeof(Quad) == 36, "Quad should stay tightly packed");
+
+    /// @brief Per-instance layout of @ref Quad, as seen by the default quad shader
+    static constexpr VertexAttrib QUAD_LAYOUT[] = {
+        { "in_rect",    4, GL_FLOAT,          GL_FALSE, offsetof(Quad, x) },
+        { "in_uv_rect", 4, GL_UNSIGNED_SHORT, GL_TRUE,  offsetof(Quad, u0) },
+        { "in_color",   4, GL_UNSIGNED_BYTE,  GL_TRUE,  offsetof(Quad, r) },
+        { "in_slot",    1, GL_UNSIGNED_BYTE,  GL_FALSE, offsetof(Quad, slot) },
+        { "in_shape",   1, GL_UNSIGNED_BYTE,  GL_FALSE, offsetof(Quad, shape) },
+        { "in_shape_params", 3, GL_UNSIGNED_SHORT, GL_FALSE, offsetof(Quad, radius) },
+    };
+
+    /// @brief Kind of geometry that a @ref DrawCall draws
+    enum class Primitive : uint16_t {
+        /// @brief Indexed triangles from @ref DrawList::vertices
+        TRIANGLES,
+        /// @brief Instanced rectangles from @ref DrawList::quads
+        QUADS,
+    };
+
+    /**
+     * @return `value` quantized to a unorm16, for normalized texture coords.
+     * Coords must be within [0, 1], so they can't repeat a texture. That's no loss, since textures clamp to their edges.
+     * Small rounding errors past either end are clamped.
+     */
+    inline uint16_t PackUnorm16(float value) {
+        assert(value >= -1e-3f && value <= 1.001f && "Texture coords must be within [0, 1]");
+        return (uint16_t)(glm::clamp(value, 0.f, 1.f) * 65535.f + 0.5f);
+    }
+
+    /** @return A distance in pixels, clamped and quantized to @ref Quad shape units */
+    inline uint16_t PackShapeUnits(float pixels) {
+        return (uint16_t)(glm::clamp(pixels * SHAPE_UNITS_PER_PIXEL, 0.f, 65535.f) + 0.5f);
+    }
+
+    /** @return `rgba` clamped to [0, 1] and quantized to unorm8 channels */
+    inline std::array<uint8_t, 4> PackColor(const glm::vec4& rgba) {
+        std::array<uint8_t, 4> packed;
+        for (int i = 0; i < 4; ++i)
+            packed[i] = (uint8_t)(glm::clamp(rgba[i], 0.f, 1.f) * 255.f + 0.5f);
+        return packed;
+    }
+
+    /**
+     * @brief Index into one of a @ref DrawList's resource tables.
+     * Handle `0` always refers to the default resource.
+     */
+    using ResourceHandle = uint16_t;
+    static constexpr ResourceHandle DEFAULT_HANDLE = 0;
+
+    /// @brief Textures that are bound together for one call of quads, each in its own texture unit
+    struct TextureSlots {
+        /// @brief Handles into @ref DrawList::textures, indexed by @ref Quad::slot
+        std::array<ResourceHandle, MAX_TEXTURE_SLOTS> textures;
+        /// @brief Number of slots in use
+        uint8_t count = 0;
+        /// @brief True if every texture was premultiplied when it was added, so they can share a blend mode
+        bool premultiplied = false;
     };
 
-    /// @details This struct is separate so we can check for equality to split/batch calls
+    /**
+     * @details This struct is separate so we can check for equality to split/batch calls.
+     * All fields are small handles, so the whole struct compares as one 64-bit @ref Key.
+     */
     struct DrawCallParams {
-        /// @brief A rectangle in `{ x, y, w, h }` format
-        glm::vec4 clip = NO_CLIP;
-        TexturePtr texture = nullptr;
-        /// @brief Use `nullptr` for the default program
-        OglProgramPtr program = nullptr;
-        glm::mat4 transform{1.f};
-
-        bool operator==(const DrawCallParams& other) const = default;
-        bool operator!=(const DrawCallParams& other) const = default;
+        /// @brief Index into @ref DrawList::textures. Use @ref DEFAULT_HANDLE for the default texture.
+        /// For @ref Primitive::QUADS, this is an index into @ref DrawList::texture_slots instead.
+        ResourceHandle texture = DEFAULT_HANDLE;
+        /// @brief Index into @ref DrawList::programs. Use @ref DEFAULT_HANDLE for the default program.
+        ResourceHandle program = DEFAULT_HANDLE;
+        /// @brief Index into @ref DrawList::clips. Use @ref DEFAULT_HANDLE to disable clipping.
+        ResourceHandle clip = DEFAULT_HANDLE;
+        /// @brief Kind of geometry in the call. Calls of different kinds are never merged.
+        Primitive primitive = Primitive::TRIANGLES;
+
+        uint64_t Key() const { return std::bit_cast<uint64_t>(*this); }
+        bool operator==(const DrawCallParams& other) const { return Key() == other.Key(); }
+        bool operator!=(const DrawCallParams& other) const { return Key() != other.Key(); }
     };
+    static_assert(sizeof(DrawCallParams) == sizeof(uint64_t));
 
+    /// @brief Header of each record in a @ref ShaderParamList, which is followed by the value
     struct ShaderParam {
+        /// @brief Uniform location in the call's program
         GLint id;
         ShaderParamType type;
-        /// Index into drawlist's storage
-        size_t index;
+        uint8_t _padding;
+        /// @brief Size of the whole record in bytes, including this header and the padding after the value
+        uint16_t size;
     };
+    static_assert(sizeof(ShaderParam) == 8, "ShaderParam should stay tightly packed");
 
+    /**
+     * @brief Shader params of a @ref DrawList, packed into one byte arena of @ref ShaderParam records.
+     * Each value directly follows its header, and every record starts on a @ref ALIGNMENT boundary.
+     * A param is only stored when it changes the program's last value in the list, so repeated values cost nothing.
+     */
     struct ShaderParamList {
-        std::vector<ShaderParam> items;
-        std::vector<int>         sp_int;
-        std::vector<float>       sp_float;
-        std::vector<glm::vec2>   sp_vec2;
-        std::vector<glm::vec3>   sp_vec3;
-        std::vector<glm::vec4>   sp_vec4;
-        std::vector<glm::mat3x3> sp_mat3x3;
-        std::vector<glm::mat4x4> sp_mat4x4;
+        static constexpr uint32_t ALIGNMENT = 8;
+
+        std::vector<uint8_t> data;
+        /// @brief Offset of the last record for each program and location, keyed by `program << 32 | location`
+        std::unordered_map<uint64_t, uint32_t> last_records;
 
         void Clear() {
-            items.clear();
-            sp_int.clear();
-            sp_float.clear();
-            sp_vec2.clear();
-            sp_vec3.clear();
-            sp_vec4.clear();
-            sp_mat3x3.clear();
-            sp_mat4x4.clear();
+            data.clear();
+            last_records.clear();
         }
 
-        std::vector<int>& _GetVec(int*) { return sp_int; }
-        std::vector<float>& _GetVec(float*) { return sp_float; }
-        std::vector<glm::vec2>& _GetVec(glm::vec2*) { return sp_vec2; }
-        std::vector<glm::vec3>& _GetVec(glm::vec3*) { return sp_vec3; }
-        std::vector<glm::vec4>& _GetVec(glm::vec4*) { return sp_vec4; }
-        std::vector<glm::mat3x3>& _GetVec(glm::mat3x3*) { return sp_mat3x3; }
-        std::vector<glm::mat4x4>& _GetVec(glm::mat4x4*) { return sp_mat4x4; }
+        /// @return Size of the arena in bytes
+        uint32_t Size() const { return (uint32_t)data.size(); }
+
+        /**
+         * @brief Add a param for a program, unless it already has the same value
+         * @return `true` if the param was added
+         */
+        bool Set(ResourceHandle program, GLint id, ShaderParamType type, const void* value) {
+            const uint32_t value_size = GetShaderParamSize(type);
+            const uint64_t key = (uint64_t)program << 32 | (uint32_t)id;
+            auto [it, inserted] = last_records.try_emplace(key, Size());
+            if (!inserted) {
+                const ShaderParam last = GetParam(it->second);
+                if (last.type == type && memcmp(data.data() + it->second + sizeof(ShaderParam), value, value_size) == 0)
+                    return false;
+                it->second = Size();
+            }
+
+            ShaderParam param = {};
+            param.id = id;
+            param.type = type;
+            param.size = (uint16_t)((sizeof(ShaderParam) + value_size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT);
+            const size_t offset = data.size();
+            data.resize(offset + param.size);
+            memcpy(data.data() + offset, &param, sizeof(param));
+            memcpy(data.data() + offset + sizeof(param), value, value_size);
+            return true;
+        }
 
         template <class T>
-        void Set(GLint id, const T& value) {
-            ShaderParamType type = ToShaderParamType((T*)nullptr);
-            std::vector<T>& vec = _GetVec((T*)nullptr);
-            vec.push_back(value);
-            items.emplace_back(id, type, vec.size()-1);
+        bool Set(ResourceHandle program, GLint id, const T& value) {
+            return Set(program, id, ToShaderParamType((T*)nullptr), &value);
+        }
+
+        /** @return The header of the record at a byte offset */
+        ShaderParam GetParam(uint32_t offset) const {
+            ShaderParam param;
+            memcpy(&param, data.data() + offset, sizeof(param));
+            return param;
+        }
+
+        /** @return The value of the record at a byte offset */
+        template <class T>
+        T GetValue(uint32_t offset) const {
+            T value;
+            memcpy(&value, data.data() + offset + sizeof(ShaderParam), sizeof(value));
+            return value;
+        }
+
+        /**
+         * @brief Copy the records within a byte range of another list, as params of `program`
+         * @return `true` if any were added
+         */
+        bool Append(const ShaderParamList& src, uint32_t offset, uint32_t size, ResourceHandle program) {
+            bool added = false;
+            for (uint32_t end = offset + size; offset < end; offset += src.GetParam(offset).size) {
+                const ShaderParam param = src.GetParam(offset);
+                added |= Set(program, param.id, param.type, src.data.data() + offset + sizeof(ShaderParam));
+            }
+            return added;
         }
     };
 
@@ -100,18 +303,53 @@ namespace Render2d {
         uint32_t index_offset = 0;
         /// @brief Number of indices
         uint32_t index_count = 0;
-        /// @brief Offset into the shader param buffer
+        /// @brief Offset into the vertex buffer. Each index is relative to this vertex.
+        uint32_t vertex_offset = 0;
+        /// @brief Byte offset of the call's first record in @ref DrawList::shader_params
         uint32_t sp_offset = 0;
-        /// @brief Number of shader params
-        uint32_t sp_count = 0;
+        /// @brief Size of the call's shader param records in bytes
+        uint32_t sp_size = 0;
         DrawCallParams params;
+        /// @brief Offset into the quad buffer, for @ref Primitive::QUADS
+        uint32_t quad_offset = 0;
+        /// @brief Number of quads, for @ref Primitive::QUADS
+        uint32_t quad_count = 0;
     };
     
-    /// @brief A list of draw calls using the same vertex and index buffer.
+    /**
+     * @brief A list of draw calls using the same vertex, index, and quad buffer.
+     * Vertices are split into chunks of up to @ref MAX_CHUNK_VERTICES, so every call can use 16-bit indices.
+     */
     struct DrawList {
+        DrawList() { Clear(); }
+
         std::vector<Vertex> vertices;
-        std::vector<uint32_t> indices;
+        std::vector<Index> indices;
+        std::vector<Quad> quads;
         std::vector<DrawCall> calls;
         ShaderParamList shader_params;
+
+        /// @brief Textures referenced by @ref DrawCallParams::texture. The first is always `nullptr`.
+        std::vector<TexturePtr> textures;
+        /// @brief Programs referenced by @ref DrawCallParams::program. The first is always `nullptr`.
+        std::vector<OglProgramPtr> programs;
+        /// @brief Texture sets referenced by the @ref DrawCallParams::texture of quads
+        std::vector<TextureSlots> texture_slots;
+        /// @brief Clip rects in `{ x, y, w, h }` format, referenced by @ref DrawCallParams::clip.
+        /// The first is always @ref NO_CLIP.
+        std::vector<glm::vec4> clips;
+
+        /** Remove all geometry and calls, and reset each resource table to its default entry */
+        void Clear() {
+            vertices.clear();
+            indices.clear();
+            quads.clear();
+            calls.clear();
+            shader_params.Clear();
+            textures.assign(1, nullptr);
+            programs.assign(1, nullptr);
+            texture_slots.clear();
+            clips.assign(1, NO_CLIP);
+        }
     };
 }
\ No newline at end of file
@@ -0,0 +1,611 @@
+#include "render2d_software.hpp"
+#include "texture.hpp"
+#include "opengl/oglframebuffer.hpp"
+#include <platform.hpp>
+#include <profiler.hpp>
+#include <util/parallel.hpp>
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define SOFTWARE_SSE2
+    #include <emmintrin.h>
+#elif defined(__wasm_simd128__)
+    #define SOFTWARE_WASM_SIMD
+    #include <wasm_simd128.h>
+#endif
+
+namespace Render2d {
+
+/// @brief Width and height of the screen tiles that are drawn in parallel
+static constexpr uint32_t TILE_SIZE = 64;
+/// @brief Fractional bits of triangle vertices, which are snapped to a grid before rasterizing
+static constexpr int SUBPIXEL_BITS = 8;
+static constexpr int64_t SUBPIXEL_ONE = 1 << SUBPIXEL_BITS;
+/// @brief Vertices are clamped this far outside the screen, in pixels, so edge functions can't overflow
+static constexpr float MAX_COORD = 1 << 20;
+
+/// @brief Whether each unsupported feature was reported, so it's only reported once
+static bool m_warned_programs = false;
+static bool m_warned_textures = false;
+
+/// @brief The blend functions that the OpenGL backend's `Render` picks for each call
+enum class BlendMode : uint8_t {
+    /// @brief `GL_ONE, GL_ONE_MINUS_SRC_ALPHA`, for premultiplied textures
+    PREMULTIPLIED,
+    /// @brief `GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA`, for straight textures drawn to the screen
+    STRAIGHT,
+    /// @brief Like @ref STRAIGHT, but alpha is `GL_ONE_MINUS_DST_ALPHA, GL_ONE`, for straight textures drawn to a @ref render_target
+    STRAIGHT_TARGET,
+};
+
+struct SoftwareBackend::CallState {
+    /// @brief Pixels that the call may draw to, as `{ x0, y0, x1, y1 }` with exclusive ends
+    glm::ivec4 bounds;
+    BlendMode blend;
+    bool is_quads;
+    /// @brief Whether the first texture is premultiplied, which also scales quad colors by their coverage
+    bool premultiplied;
+    /// @brief Client copy of each texture slot, or `nullptr` for plain white
+    std::array<const ClientTexture*, MAX_TEXTURE_SLOTS> textures;
+};
+
+SoftwareBackend::SoftwareBackend() = default;
+SoftwareBackend::~SoftwareBackend() = default;
+
+/** @return Exact `x / 255`, rounded, for any `x <= 255 * 255` */
+static inline uint32_t Div255(uint32_t x) {
+    x += 128;
+    return (x + (x >> 8)) >> 8;
+}
+
+static inline uint8_t Quantize(float value) {
+    return (uint8_t)(glm::clamp(value, 0.f, 1.f) * 255.f + 0.5f);
+}
+
+/** Blend one RGBA8 pixel over another. The SIMD paths below must match this exactly. */
+static inline void BlendPixel(uint8_t* dst, const uint8_t* src, BlendMode mode) {
+    const uint32_t sa = src[3], inv_sa = 255 - sa;
+    const uint8_t da = dst[3];
+    for (int i = 0; i < 4; ++i) {
+        if (mode == BlendMode::PREMULTIPLIED)
+            dst[i] = (uint8_t)std::min<uint32_t>(255, src[i] + Div255(dst[i] * inv_sa));
+        else
+            dst[i] = (uint8_t)Div255(src[i] * sa + dst[i] * inv_sa);
+    }
+    if (mode == BlendMode::STRAIGHT_TARGET)
+        dst[3] = (uint8_t)(Div255(sa * (255 - da)) + da);
+}
+
+#if defined(SOFTWARE_SSE2)
+static inline __m128i Div255(__m128i x) {
+    x = _mm_add_epi16(x, _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+}
+
+/** Blend two pixels, widened to 16-bit channels */
+static inline __m128i BlendWide(__m128i src, __m128i dst, BlendMode mode) {
+    const __m128i sa = _mm_shufflehi_epi16(_mm_shufflelo_epi16(src, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+    const __m128i inv_sa = _mm_sub_epi16(_mm_set1_epi16(255), sa);
+    if (mode == BlendMode::PREMULTIPLIED)
+        return _mm_add_epi16(src, Div255(_mm_mullo_epi16(dst, inv_sa)));
+
+    __m128i out = Div255(_mm_add_epi16(_mm_mullo_epi16(src, sa), _mm_mullo_epi16(dst, inv_sa)));
+    if (mode == BlendMode::STRAIGHT_TARGET) {
+        const __m128i alpha = _mm_add_epi16(Div255(_mm_mullo_epi16(sa, _mm_sub_epi16(_mm_set1_epi16(255), dst))), dst);
+        const __m128i alpha_mask = _mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0);
+        out = _mm_or_si128(_mm_and_si128(alpha_mask, alpha), _mm_andnot_si128(alpha_mask, out));
+    }
+    return out;
+}
+
+/** Blend four pixels */
+static inline __m128i Blend4(__m128i src, __m128i dst, BlendMode mode) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i lo = BlendWide(_mm_unpacklo_epi8(src, zero), _mm_unpacklo_epi8(dst, zero), mode);
+    const __m128i hi = BlendWide(_mm_unpackhi_epi8(src, zero), _mm_unpackhi_epi8(dst, zero), mode);
+    // Saturates premultiplied colors that overflow, like the scalar path
+    return _mm_packus_epi16(lo, hi);
+}
+#elif defined(SOFTWARE_WASM_SIMD)
+static inline v128_t Div255(v128_t x) {
+    x = wasm_i16x8_add(x, wasm_i16x8_splat(128));
+    return wasm_u16x8_shr(wasm_i16x8_add(x, wasm_u16x8_shr(x, 8)), 8);
+}
+
+/** Blend two pixels, widened to 16-bit channels */
+static inline v128_t BlendWide(v128_t src, v128_t dst, BlendMode mode) {
+    const v128_t sa = wasm_i16x8_shuffle(src, src, 3, 3, 3, 3, 7, 7, 7, 7);
+    const v128_t inv_sa = wasm_i16x8_sub(wasm_i16x8_splat(255), sa);
+    if (mode == BlendMode::PREMULTIPLIED)
+        return wasm_i16x8_add(src, Div255(wasm_i16x8_mul(dst, inv_sa)));
+
+    v128_t out = Div255(wasm_i16x8_add(wasm_i16x8_mul(src, sa), wasm_i16x8_mul(dst, inv_sa)));
+    if (mode == BlendMode::STRAIGHT_TARGET) {
+        const v128_t alpha = wasm_i16x8_add(Div255(wasm_i16x8_mul(sa, wasm_i16x8_sub(wasm_i16x8_splat(255), dst))), dst);
+        const v128_t alpha_mask = wasm_i16x8_make(0, 0, 0, -1, 0, 0, 0, -1);
+        out = wasm_v128_bitselect(alpha, out, alpha_mask);
+    }
+    return out;
+}
+
+/** Blend four pixels */
+static inline v128_t Blend4(v128_t src, v128_t dst, BlendMode mode) {
+    const v128_t lo = BlendWide(wasm_u16x8_extend_low_u8x16(src), wasm_u16x8_extend_low_u8x16(dst), mode);
+    const v128_t hi = BlendWide(wasm_u16x8_extend_high_u8x16(src), wasm_u16x8_extend_high_u8x16(dst), mode);
+    // Saturates premultiplied colors that overflow, like the scalar path
+    return wasm_u8x16_narrow_i16x8(lo, hi);
+}
+#endif
+
+/** Blend a span of RGBA8 pixels over `dst` */
+static void BlendSpan(uint8_t* dst, const uint8_t* src, uint32_t count, BlendMode mode) {
+    uint32_t i = 0;
+#if defined(SOFTWARE_SSE2)
+    for (; i + 4 <= count; i += 4) {
+        __m128i* d = (__m128i*)(dst + i * 4);
+        _mm_storeu_si128(d, Blend4(_mm_loadu_si128((const __m128i*)(src + i * 4)), _mm_loadu_si128(d), mode));
+    }
+#elif defined(SOFTWARE_WASM_SIMD)
+    for (; i + 4 <= count; i += 4)
+        wasm_v128_store(dst + i * 4, Blend4(wasm_v128_load(src + i * 4), wasm_v128_load(dst + i * 4), mode));
+#endif
+    for (; i < count; ++i)
+        BlendPixel(dst + i * 4, src + i * 4, mode);
+}
+
+/** Blend one RGBA8 color over a span of pixels */
+static void FillSpan(uint8_t* dst, const uint8_t color[4], uint32_t count, BlendMode mode) {
+    if (mode != BlendMode::PREMULTIPLIED && color[3] == 0)
+        return;
+    uint32_t packed;
+    memcpy(&packed, color, 4);
+    // Opaque colors replace the destination in every mode
+    if (color[3] == 255) {
+        for (uint32_t i = 0; i < count; ++i)
+            memcpy(dst + i * 4, &packed, 4);
+        return;
+    }
+
+    uint32_t i = 0;
+#if defined(SOFTWARE_SSE2)
+    const __m128i src = _mm_set1_epi32((int)packed);
+    for (; i + 4 <= count; i += 4) {
+        __m128i* d = (__m128i*)(dst + i * 4);
+        _mm_storeu_si128(d, Blend4(src, _mm_loadu_si128(d), mode));
+    }
+#elif defined(SOFTWARE_WASM_SIMD)
+    const v128_t src = wasm_i32x4_splat((int)packed);
+    for (; i + 4 <= count; i += 4)
+        wasm_v128_store(dst + i * 4, Blend4(src, wasm_v128_load(dst + i * 4), mode));
+#endif
+    for (; i < count; ++i)
+        BlendPixel(dst + i * 4, color, mode);
+}
+
+static glm::vec4 FetchTexel(const ClientTexture& texture, uint32_t x, uint32_t y) {
+    const uint8_t* p = texture.GetPixel(x, y);
+    switch (texture.GetInfo().format) {
+    // Sampled like GL_ALPHA
+    case TextureFormat::A_8_8: return glm::vec4(0, 0, 0, p[0] / 255.f);
+    case TextureFormat::RGB_8_24: return glm::vec4(p[0] / 255.f, p[1] / 255.f, p[2] / 255.f, 1);
+    default: return glm::vec4(p[0] / 255.f, p[1] / 255.f, p[2] / 255.f, p[3] / 255.f);
+    }
+}
+
+/** Sample a texture with bilinear filtering and clamped edges, like the OpenGL backend's textures */
+static glm::vec4 Sample(const ClientTexture* texture, glm::vec2 uv) {
+    if (!texture)
+        return glm::vec4(1);
+    const TextureInfo& info = texture->GetInfo();
+    const float x = glm::clamp(uv.x, 0.f, 1.f) * info.width - 0.5f;
+    const float y = glm::clamp(uv.y, 0.f, 1.f) * info.height - 0.5f;
+    const float fx = std::floor(x), fy = std::floor(y);
+    const float tx = x - fx, ty = y - fy;
+    const uint32_t x0 = (uint32_t)std::max(fx, 0.f), y0 = (uint32_t)std::max(fy, 0.f);
+    const uint32_t x1 = std::min(x0 + (fx >= 0), info.width - 1);
+    const uint32_t y1 = std::min(y0 + (fy >= 0), info.height - 1);
+    return glm::mix(
+        glm::mix(FetchTexel(*texture, x0, y0), FetchTexel(*texture, x1, y0), tx),
+        glm::mix(FetchTexel(*texture, x0, y1), FetchTexel(*texture, x1, y1), tx),
+        ty);
+}
+
+/** Port of `ShapeCoverage` in the default quad fragment shader */
+static float ShapeCoverage(QuadShape shape, glm::vec2 p, glm::vec2 extent, glm::vec3 params) {
+    if (shape == QuadShape::RECT)
+        return 1.f;
+    float dist;
+    if (shape == QuadShape::ROUNDED_RECT) {
+        const float radius = std::min(params.x, std::min(extent.x, extent.y));
+        const glm::vec2 q = glm::abs(p) - extent + radius;
+        dist = glm::length(glm::max(q, 0.f)) + std::min(std::max(q.x, q.y), 0.f) - radius;
+    } else {
+        extent = glm::max(extent, 1e-3f);
+        const float k0 = glm::length(p / extent);
+        const float k1 = glm::length(p / (extent * extent));
+        dist = k1 > 0.f ? k0 * (k0 - 1.f) / k1 : -std::min(extent.x, extent.y);
+    }
+    const float border = params.y;
+    if (border > 0.f)
+        dist = std::abs(dist + border * 0.5f) - border * 0.5f;
+    const float softness = params.z;
+    if (softness > 0.f)
+        return 1.f - glm::smoothstep(-softness, softness, dist);
+    return glm::clamp(0.5f - dist, 0.f, 1.f);
+}
+
+/** @return The first pixel whose center is at or after `coord`, so shared edges are drawn once */
+static int32_t FirstPixel(float coord) { return (int32_t)std::ceil(coord - 0.5f); }
+
+bool SoftwareBackend::Setup() {
+    Texture::SetKeepClientCopies(true);
+    return true;
+}
+
+void SoftwareBackend::Cleanup() {
+    Texture::SetKeepClientCopies(false);
+    if (m_present_texture)
+        glDeleteTextures(1, &m_present_texture);
+    m_present_texture = 0;
+    m_present_framebuffer = nullptr;
+}
+
+void SoftwareBackend::Render() {
+    NullBackend::Render();
+    PROFILE_ZONE("Render2d::SoftwareBackend::Render");
+
+    const uint32_t width = (uint32_t)std::max(m_screen_w, 0.f);
+    const uint32_t height = (uint32_t)std::max(m_screen_h, 0.f);
+    if (width == 0 || height == 0)
+        return;
+    if (!m_target || m_target->GetInfo().width != width || m_target->GetInfo().height != height)
+        m_target = ClientTexture::Create(TextureInfo(TextureFormat::RGBA_8_32, width, height, render_target != nullptr));
+
+    m_tiles_x = (width + TILE_SIZE - 1) / TILE_SIZE;
+    m_tiles_y = (height + TILE_SIZE - 1) / TILE_SIZE;
+    m_bins.resize(m_tiles_x * m_tiles_y);
+    for (std::vector<BinItem>& bin : m_bins)
+        bin.clear();
+    m_calls.clear();
+    if (m_drawlist) {
+        PrepareCalls();
+        BinPrimitives();
+    }
+
+    ParallelFor(m_bins.size(), [this](size_t tile) { DrawTile((uint32_t)tile); });
+
+    if (present)
+        Present();
+}
+
+void SoftwareBackend::PrepareCalls() {
+    const DrawList& list = *m_drawlist;
+    const glm::ivec4 screen = { 0, 0, (int32_t)m_target->GetInfo().width, (int32_t)m_target->GetInfo().height };
+    auto resolve = [&](ResourceHandle handle) -> const ClientTexture* {
+        const Texture* texture = list.textures[handle].get();
+        if (!texture)
+            return nullptr;
+        const ClientTexture* copy = texture->GetClientCopy().get();
+        if (!copy && !m_warned_textures) {
+            PLATFORM_WARNING("SoftwareBackend draws textures without client copies as white. Set it up before creating textures.");
+            m_warned_textures = true;
+        }
+        return copy;
+    };
+
+    m_calls.resize(list.calls.size());
+    for (size_t i = 0; i < list.calls.size(); ++i) {
+        const DrawCall& call = list.calls[i];
+        CallState& state = m_calls[i];
+        state.is_quads = call.params.primitive == Primitive::QUADS;
+        state.textures.fill(nullptr);
+        if (state.is_quads) {
+            const TextureSlots& slots = list.texture_slots[call.params.texture];
+            for (uint8_t slot = 0; slot < slots.count; ++slot)
+                state.textures[slot] = resolve(slots.textures[slot]);
+            state.premultiplied = list.textures[slots.textures[0]] && list.textures[slots.textures[0]]->GetInfo().premul;
+        } else {
+            state.textures[0] = resolve(call.params.texture);
+            state.premultiplied = list.textures[call.params.texture] && list.textures[call.params.texture]->GetInfo().premul;
+        }
+        if (call.params.program != DEFAULT_HANDLE && !m_warned_programs) {
+            PLATFORM_WARNING("SoftwareBackend draws calls with user programs using the default shading");
+            m_warned_programs = true;
+        }
+
+        if (state.premultiplied)
+            state.blend = BlendMode::PREMULTIPLIED;
+        else if (render_target)
+            state.blend = BlendMode::STRAIGHT_TARGET;
+        else
+            state.blend = BlendMode::STRAIGHT;
+
+        state.bounds = screen;
+        if (call.params.clip != DEFAULT_HANDLE) {
+            // Rounded like the OpenGL backend's scissor rect
+            const glm::ivec4 clip = glm::ivec4(glm::round(list.clips[call.params.clip]));
+            state.bounds = glm::ivec4(
+                std::max(screen.x, clip.x), std::max(screen.y, clip.y),
+                std::min(screen.z, clip.x + clip.z), std::min(screen.w, clip.y + clip.w));
+        }
+    }
+}
+
+void SoftwareBackend::BinPrimitives() {
+    PROFILE_ZONE("Render2d::SoftwareBackend::BinPrimitives");
+    const DrawList& list = *m_drawlist;
+
+    // Bounds are conservative, since each tile tests its pixels exactly
+    auto bin = [&](uint32_t call, uint32_t primitive, glm::vec2 min, glm::vec2 max) {
+        const glm::ivec4& bounds = m_calls[call].bounds;
+        // Also rejects NaN
+        if (!(min.x < bounds.z && min.y < bounds.w && max.x >= bounds.x && max.y >= bounds.y))
+            return;
+        const int32_t x0 = std::max(bounds.x, (int32_t)min.x), y0 = std::max(bounds.y, (int32_t)min.y);
+        const int32_t x1 = std::min(bounds.z - 1, (int32_t)max.x), y1 = std::min(bounds.w - 1, (int32_t)max.y);
+        if (x0 > x1 || y0 > y1)
+            return;
+        for (int32_t ty = y0 / (int32_t)TILE_SIZE; ty <= y1 / (int32_t)TILE_SIZE; ++ty) {
+            for (int32_t tx = x0 / (int32_t)TILE_SIZE; tx <= x1 / (int32_t)TILE_SIZE; ++tx)
+                m_bins[ty * m_tiles_x + tx].push_back({ call, primitive });
+        }
+    };
+
+    for (uint32_t i = 0; i < (uint32_t)list.calls.size(); ++i) {
+        const DrawCall& call = list.calls[i];
+        if (m_calls[i].bounds.x >= m_calls[i].bounds.z || m_calls[i].bounds.y >= m_calls[i].bounds.w)
+            continue;
+        if (m_calls[i].is_quads) {
+            for (uint32_t q = call.quad_offset; q < call.quad_offset + call.quad_count; ++q) {
+                const Quad& quad = list.quads[q];
+                const glm::vec2 a = { quad.x, quad.y }, b = { quad.x + quad.w, quad.y + quad.h };
+                bin(i, q, glm::clamp(glm::min(a, b), -MAX_COORD, MAX_COORD), glm::clamp(glm::max(a, b), -MAX_COORD, MAX_COORD));
+            }
+            continue;
+        }
+        for (uint32_t t = call.index_offset; t + 3 <= call.index_offset + call.index_count; t += 3) {
+            const Vertex* v = list.vertices.data() + call.vertex_offset;
+            const Index* idx = list.indices.data() + t;
+            const glm::vec2 p0 = { v[idx[0]].x, v[idx[0]].y }, p1 = { v[idx[1]].x, v[idx[1]].y }, p2 = { v[idx[2]].x, v[idx[2]].y };
+            bin(i, t, glm::clamp(glm::min(p0, glm::min(p1, p2)), -MAX_COORD, MAX_COORD),
+                glm::clamp(glm::max(p0, glm::max(p1, p2)), -MAX_COORD, MAX_COORD));
+        }
+    }
+}
+
+/** Color of a @ref Vertex as normalized floats */
+static glm::vec4 VertexColor(const Vertex& v) {
+    return glm::vec4(v.r, v.g, v.b, v.a) / 255.f;
+}
+
+static glm::vec2 VertexUv(const Vertex& v) {
+    return glm::vec2(v.u, v.v) / 65535.f;
+}
+
+/** Quantize a shaded color into a span, as RGBA8 */
+static inline void StorePixel(uint8_t* dst, const glm::vec4& color) {
+    for (int i = 0; i < 4; ++i)
+        dst[i] = Quantize(color[i]);
+}
+
+/**
+ * @brief Draw one quad within a tile's pixel rect
+ * @param rect The tile, clipped to the call's bounds, as `{ x0, y0, x1, y1 }`
+ */
+static void DrawQuad(ClientTexture& target, const Quad& quad, const std::array<const ClientTexture*, MAX_TEXTURE_SLOTS>& textures,
+    bool premultiplied, BlendMode blend, const glm::ivec4& rect) {
+    const float qx0 = std::min(quad.x, quad.x + quad.w), qx1 = std::max(quad.x, quad.x + quad.w);
+    const float qy0 = std::min(quad.y, quad.y + quad.h), qy1 = std::max(quad.y, quad.y + quad.h);
+    const int32_t x0 = std::max(rect.x, FirstPixel(glm::clamp(qx0, -MAX_COORD, MAX_COORD)));
+    const int32_t x1 = std::min(rect.z, FirstPixel(glm::clamp(qx1, -MAX_COORD, MAX_COORD)));
+    const int32_t y0 = std::max(rect.y, FirstPixel(glm::clamp(qy0, -MAX_COORD, MAX_COORD)));
+    const int32_t y1 = std::min(rect.w, FirstPixel(glm::clamp(qy1, -MAX_COORD, MAX_COORD)));
+    if (x0 >= x1 || y0 >= y1)
+        return;
+
+    const glm::vec4 color = glm::vec4(quad.r, quad.g, quad.b, quad.a) / 255.f;
+    const ClientTexture* texture = quad.slot < MAX_TEXTURE_SLOTS ? textures[quad.slot] : nullptr;
+    const QuadShape shape = (QuadShape)quad.shape;
+
+    // Untextured rects are one color, so the whole span is blended at once
+    if (!texture && shape == QuadShape::RECT) {
+        uint8_t packed[4];
+        StorePixel(packed, color);
+        for (int32_t y = y0; y < y1; ++y)
+            FillSpan(target.GetPixel(x0, y), packed, x1 - x0, blend);
+        return;
+    }
+
+    const glm::vec2 size = glm::abs(glm::vec2(quad.w, quad.h));
+    const glm::vec3 params = glm::vec3(quad.radius, quad.border, quad.softness) / SHAPE_UNITS_PER_PIXEL;
+    const glm::vec2 extent = glm::max(size * 0.5f - params.z, 0.f);
+    const glm::vec2 uv0 = glm::vec2(quad.u0, quad.v0) / 65535.f, uv1 = glm::vec2(quad.u1, quad.v1) / 65535.f;
+    uint8_t span[TILE_SIZE * 4];
+    for (int32_t y = y0; y < y1; ++y) {
+        for (int32_t x = x0; x < x1; ++x) {
+            const glm::vec2 corner = (glm::vec2(x + 0.5f, y + 0.5f) - glm::vec2(quad.x, quad.y)) / glm::vec2(quad.w, quad.h);
+            glm::vec4 frag = Sample(texture, glm::mix(uv0, uv1, corner)) * color;
+            const float coverage = ShapeCoverage(shape, (corner - 0.5f) * size, extent, params);
+            frag.a *= coverage;
+            if (premultiplied)
+                frag = glm::vec4(glm::vec3(frag) * coverage, frag.a);
+            StorePixel(span + (x - x0) * 4, frag);
+        }
+        BlendSpan(target.GetPixel(x0, y), span, x1 - x0, blend);
+    }
+}
+
+/** A vertex snapped to @ref SUBPIXEL_BITS */
+struct FixedVertex {
+    int64_t x, y;
+    const Vertex* vertex;
+};
+
+/** @return Twice the signed area of `a, b, p`, which is positive when `p` is inside the edge `a, b` of a positive triangle */
+static inline int64_t Orient(const FixedVertex& a, const FixedVertex& b, int64_t px, int64_t py) {
+    return (b.x - a.x) * (py - a.y) - (b.y - a.y) * (px - a.x);
+}
+
+/**
+ * @brief Draw one triangle within a tile's pixel rect.
+ * Pixel centers on an edge are drawn by only one of the triangles that share it, so meshes don't blend seams twice.
+ */
+static void DrawTriangle(ClientTexture& target, const Vertex* v0, const Vertex* v1, const Vertex* v2,
+    const ClientTexture* texture, BlendMode blend, const glm::ivec4& rect) {
+    for (const Vertex* v : { v0, v1, v2 }) {
+        if (!std::isfinite(v->x) || !std::isfinite(v->y))
+            return;
+    }
+    auto snap = [](const Vertex* v) {
+        return FixedVertex{
+            (int64_t)std::lround(glm::clamp(v->x, -MAX_COORD, MAX_COORD) * SUBPIXEL_ONE),
+            (int64_t)std::lround(glm::clamp(v->y, -MAX_COORD, MAX_COORD) * SUBPIXEL_ONE),
+            v };
+    };
+    std::array<FixedVertex, 3> p = { snap(v0), snap(v1), snap(v2) };
+    int64_t area = Orient(p[0], p[1], p[2].x, p[2].y);
+    if (area == 0)
+        return;
+    if (area < 0) {
+        std::swap(p[1], p[2]);
+        area = -area;
+    }
+
+    const int32_t x0 = std::max<int64_t>(rect.x, std::min({ p[0].x, p[1].x, p[2].x }) >> SUBPIXEL_BITS);
+    const int32_t y0 = std::max<int64_t>(rect.y, std::min({ p[0].y, p[1].y, p[2].y }) >> SUBPIXEL_BITS);
+    const int32_t x1 = std::min<int64_t>(rect.z, (std::max({ p[0].x, p[1].x, p[2].x }) >> SUBPIXEL_BITS) + 1);
+    const int32_t y1 = std::min<int64_t>(rect.w, (std::max({ p[0].y, p[1].y, p[2].y }) >> SUBPIXEL_BITS) + 1);
+    if (x0 >= x1 || y0 >= y1)
+        return;
+
+    // Edge `i` is opposite vertex `i`, so its value is that vertex's barycentric weight
+    struct Edge {
+        int64_t row;
+        int64_t step_x, step_y;
+        /// @brief `1` to exclude pixel centers exactly on the edge
+        int64_t bias;
+    };
+    std::array<Edge, 3> edges;
+    const int64_t start_x = (int64_t)x0 * SUBPIXEL_ONE + SUBPIXEL_ONE / 2;
+    const int64_t start_y = (int64_t)y0 * SUBPIXEL_ONE + SUBPIXEL_ONE / 2;
+    for (int i = 0; i < 3; ++i) {
+        const FixedVertex& a = p[(i + 1) % 3];
+        const FixedVertex& b = p[(i + 2) % 3];
+        const int64_t dx = b.x - a.x, dy = b.y - a.y;
+        edges[i].row = Orient(a, b, start_x, start_y);
+        edges[i].step_x = -dy * SUBPIXEL_ONE;
+        edges[i].step_y = dx * SUBPIXEL_ONE;
+        // Top-left rule: with y down, positive triangles go up their left edges and right along their top edges
+        edges[i].bias = (dy < 0 || (dy == 0 && dx > 0)) ? 0 : 1;
+    }
+
+    const glm::vec4 c0 = VertexColor(*p[0].vertex), c1 = VertexColor(*p[1].vertex), c2 = VertexColor(*p[2].vertex);
+    const glm::vec2 uv0 = VertexUv(*p[0].vertex), uv1 = VertexUv(*p[1].vertex), uv2 = VertexUv(*p[2].vertex);
+    // Untextured triangles of one color are blended a span at a time
+    const bool is_flat = !texture && c0 == c1 && c1 == c2;
+    uint8_t flat_color[4];
+    StorePixel(flat_color, c0);
+    const double inv_area = 1.0 / (double)area;
+    uint8_t span[TILE_SIZE * 4];
+
+    for (int32_t y = y0; y < y1; ++y) {
+        int64_t e[3] = { edges[0].row, edges[1].row, edges[2].row };
+        int32_t span_begin = -1, span_end = x1;
+        for (int32_t x = x0; x < x1; ++x) {
+            const bool inside = e[0] - edges[0].bias >= 0 && e[1] - edges[1].bias >= 0 && e[2] - edges[2].bias >= 0;
+            if (inside && span_begin < 0)
+                span_begin = x;
+            else if (!inside && span_begin >= 0) {
+                // Triangles are convex, so the row's span is over
+                span_end = x;
+                break;
+            }
+            if (inside && !is_flat) {
+                const float w0 = (float)(e[0] * inv_area), w1 = (float)(e[1] * inv_area), w2 = (float)(e[2] * inv_area);
+                const glm::vec2 uv = uv0 * w0 + uv1 * w1 + uv2 * w2;
+                const glm::vec4 color = c0 * w0 + c1 * w1 + c2 * w2;
+                StorePixel(span + (x - x0) * 4, Sample(texture, uv) * color);
+            }
+            for (int i = 0; i < 3; ++i)
+                e[i] += edges[i].step_x;
+        }
+        if (span_begin >= 0) {
+            if (is_flat)
+                FillSpan(target.GetPixel(span_begin, y), flat_color, span_end - span_begin, blend);
+            else
+                BlendSpan(target.GetPixel(span_begin, y), span + (span_begin - x0) * 4, span_end - span_begin, blend);
+        }
+        for (int i = 0; i < 3; ++i)
+            edges[i].row += edges[i].step_y;
+    }
+}
+
+void SoftwareBackend::DrawTile(uint32_t tile) {
+    ClientTexture& target = *m_target;
+    const int32_t tile_x = (int32_t)(tile % m_tiles_x * TILE_SIZE);
+    const int32_t tile_y = (int32_t)(tile / m_tiles_x * TILE_SIZE);
+    const glm::ivec4 tile_rect = {
+        tile_x, tile_y,
+        std::min<int32_t>(tile_x + TILE_SIZE, target.GetInfo().width),
+        std::min<int32_t>(tile_y + TILE_SIZE, target.GetInfo().height),
+    };
+
+    uint8_t clear[4];
+    StorePixel(clear, clear_color);
+    uint32_t packed_clear;
+    memcpy(&packed_clear, clear, 4);
+    for (int32_t y = tile_rect.y; y < tile_rect.w; ++y) {
+        uint8_t* row = target.GetPixel(tile_rect.x, y);
+        for (int32_t x = tile_rect.x; x < tile_rect.z; ++x)
+            memcpy(row + (x - tile_rect.x) * 4, &packed_clear, 4);
+    }
+
+    for (const BinItem& item : m_bins[tile]) {
+        const CallState& state = m_calls[item.call];
+        const glm::ivec4 rect = {
+            std::max(tile_rect.x, state.bounds.x), std::max(tile_rect.y, state.bounds.y),
+            std::min(tile_rect.z, state.bounds.z), std::min(tile_rect.w, state.bounds.w),
+        };
+        if (state.is_quads) {
+            DrawQuad(target, m_drawlist->quads[item.primitive], state.textures, state.premultiplied, state.blend, rect);
+            continue;
+        }
+        const DrawCall& call = m_drawlist->calls[item.call];
+        const Vertex* vertices = m_drawlist->vertices.data() + call.vertex_offset;
+        const Index* indices = m_drawlist->indices.data() + item.primitive;
+        DrawTriangle(target, &vertices[indices[0]], &vertices[indices[1]], &vertices[indices[2]], state.textures[0], state.blend, rect);
+    }
+}
+
+void SoftwareBackend::Present() {
+    const TextureInfo& info = m_target->GetInfo();
+    if (render_target) {
+        if (render_target->GetInfo().width != info.width || render_target->GetInfo().height != info.height) {
+            PLATFORM_WARNING("SoftwareBackend can't present to a render target of a different size");
+            return;
+        }
+        render_target->Write(0, 0, info.width, info.height, m_target->GetData());
+        return;
+    }
+
+    if (!m_present_texture)
+        glGenTextures(1, &m_present_texture);
+    glBindTexture(GL_TEXTURE_2D, m_present_texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, info.width, info.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, m_target->GetData());
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    if (!m_present_framebuffer)
+        m_present_framebuffer = std::make_unique<OglFramebuffer>();
+    m_present_framebuffer->SetColorAttachmentInternal(m_present_texture, 0);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_present_framebuffer->GlHandle());
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    // The target's first row is the top of the frame, and the screen's is the bottom
+    glBlitFramebuffer(0, 0, info.width, info.height, 0, info.height, info.width, 0, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include "render2d_backend.hpp"
+#include <glm/vec4.hpp>
+#include <memory>
+#include <vector>
+
+class OglFramebuffer;
+
+namespace Render2d {
+    /**
+     * @brief A backend that rasterizes lists on the CPU into a @ref ClientTexture.
+     * The screen is split into tiles that are drawn in parallel, and spans are blended with SSE2 or WebAssembly SIMD when available.
+     * Every step uses fixed rules and integer blending, so a frame has the same pixels on every machine and thread count.
+     *
+     * Textures are sampled from the copies kept by @ref Texture::SetKeepClientCopies, which @ref Setup enables.
+     * Calls with user programs are drawn with the default shading, since GLSL can't run here.
+     */
+    class SoftwareBackend : public NullBackend {
+    public:
+        SoftwareBackend();
+        ~SoftwareBackend() override;
+
+        /// @brief Color that the target is cleared to before each frame, as straight RGBA
+        glm::vec4 clear_color = glm::vec4(0);
+        /**
+         * @brief Also copy each frame to @ref render_target, or to the screen if it's `nullptr`.
+         * This needs a GL context, but not a working GL renderer.
+         */
+        bool present = false;
+
+        /** Keep client copies of textures created from now on */
+        bool Setup() override;
+        void Cleanup() override;
+        /** Validate and count the list like @ref NullBackend, then draw it into the target */
+        void Render() override;
+
+        /** @return The last frame, in @ref TextureFormat::RGBA_8_32 at the size of the screen */
+        ClientTextureConstPtr GetTarget() const { return m_target; }
+
+    private:
+        struct CallState;
+        /// @brief A primitive that may touch a tile: the first index of a triangle, or the index of a quad
+        struct BinItem {
+            uint32_t call;
+            uint32_t primitive;
+        };
+
+        /** Resolve the textures, blend mode and bounds of each call */
+        void PrepareCalls();
+        /** Add each primitive to the bins of the tiles its bounds touch */
+        void BinPrimitives();
+        /** Clear one tile, then draw the primitives in its bin, in order */
+        void DrawTile(uint32_t tile);
+        /** Copy the target to the GL framebuffer, for @ref present */
+        void Present();
+
+        ClientTexturePtr m_target;
+        uint32_t m_tiles_x = 0;
+        uint32_t m_tiles_y = 0;
+        std::vector<std::vector<BinItem>> m_bins;
+        std::vector<CallState> m_calls;
+
+        GLuint m_present_texture = 0;
+        std::unique_ptr<OglFramebuffer> m_present_framebuffer;
+    };
+}
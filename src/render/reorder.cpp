@@ -0,0 +1,170 @@
+#include "reorder.hpp"
+#include "render2d_list.hpp"
+#include <glm/vec2.hpp>
+#include <glm/common.hpp>
+#include <vector>
+#include <limits>
+#include <cassert>
+
+namespace Render2d {
+
+namespace {
+
+struct Bounds {
+    glm::vec2 min = glm::vec2(std::numeric_limits<float>::max());
+    glm::vec2 max = glm::vec2(std::numeric_limits<float>::lowest());
+
+    void Add(glm::vec2 point) {
+        min = glm::min(min, point);
+        max = glm::max(max, point);
+    }
+    void Add(const Bounds& other) {
+        min = glm::min(min, other.min);
+        max = glm::max(max, other.max);
+    }
+    bool Overlaps(const Bounds& other) const {
+        return min.x < other.max.x && other.min.x < max.x
+            && min.y < other.max.y && other.min.y < max.y;
+    }
+};
+
+/// @brief One call in the reordered list, made from one or more of the original calls
+struct Group {
+    /// @brief Index of each original call, in drawing order
+    std::vector<uint32_t> calls;
+    Bounds bounds;
+};
+
+Bounds GetCallBounds(const DrawList& list, const DrawCall& call) {
+    Bounds bounds;
+    for (uint32_t i = 0; i < call.index_count; ++i) {
+        const Vertex& vertex = list.vertices[call.vertex_offset + list.indices[call.index_offset + i]];
+        bounds.Add(glm::vec2(vertex.x, vertex.y));
+    }
+    for (uint32_t i = 0; i < call.quad_count; ++i) {
+        const Quad& quad = list.quads[call.quad_offset + i];
+        bounds.Add(glm::vec2(quad.x, quad.y));
+        bounds.Add(glm::vec2(quad.x + quad.w, quad.y + quad.h));
+    }
+    return bounds;
+}
+
+/** @return `true` if `call` can be drawn as part of `target`, assuming nothing in between overlaps */
+bool CanMerge(const DrawCall& target, const DrawCall& call) {
+    if (target.params != call.params || call.sp_size > 0)
+        return false;
+    // Indices are relative to the vertex chunk
+    return call.params.primitive == Primitive::QUADS || target.vertex_offset == call.vertex_offset;
+}
+
+#ifndef NDEBUG
+/**
+ * @brief Check that no call was moved back past a call that overlaps it or sets shader params
+ * @param call_bounds Bounds of each original call
+ */
+bool KeepsDrawOrder(const DrawList& list, const std::vector<Group>& groups, const std::vector<Bounds>& call_bounds) {
+    std::vector<size_t> group_of(list.calls.size());
+    for (size_t g = 0; g < groups.size(); ++g) {
+        for (uint32_t c : groups[g].calls)
+            group_of[c] = g;
+    }
+    // A call in a later group than `g` is now drawn after every call of `g`
+    for (size_t g = 0; g < groups.size(); ++g) {
+        const std::vector<uint32_t>& calls = groups[g].calls;
+        for (size_t i = 1; i < calls.size(); ++i) {
+            for (uint32_t skipped = calls.front() + 1; skipped < calls[i]; ++skipped) {
+                if (group_of[skipped] <= g)
+                    continue;
+                if (list.calls[skipped].sp_size > 0 || call_bounds[skipped].Overlaps(call_bounds[calls[i]]))
+                    return false;
+            }
+        }
+    }
+    return true;
+}
+#endif
+
+}
+
+size_t ReorderCalls(DrawList& list, size_t max_lookback) {
+    if (list.calls.size() < 2)
+        return 0;
+
+    std::vector<Group> groups;
+    groups.reserve(list.calls.size());
+#ifndef NDEBUG
+    std::vector<Bounds> call_bounds;
+    call_bounds.reserve(list.calls.size());
+#endif
+
+    for (uint32_t c = 0; c < list.calls.size(); ++c) {
+        const DrawCall& call = list.calls[c];
+        Bounds bounds = GetCallBounds(list, call);
+#ifndef NDEBUG
+        call_bounds.push_back(bounds);
+#endif
+
+        // Search back for a matching group, without jumping over anything drawn on top of this call
+        Group* target = nullptr;
+        size_t lookback_end = groups.size() > max_lookback ? groups.size() - max_lookback : 0;
+        for (size_t g = groups.size(); g > lookback_end; --g) {
+            Group& group = groups[g-1];
+            const DrawCall& group_call = list.calls[group.calls.front()];
+            if (CanMerge(group_call, call)) {
+                target = &group;
+                break;
+            }
+            // Shader params change state for every later call with the same program
+            if (group_call.sp_size > 0 || group.bounds.Overlaps(bounds))
+                break;
+        }
+
+        if (!target) {
+            groups.emplace_back();
+            target = &groups.back();
+        }
+        target->calls.push_back(c);
+        target->bounds.Add(bounds);
+    }
+
+    size_t num_saved = list.calls.size() - groups.size();
+    if (num_saved == 0)
+        return 0;
+    assert(KeepsDrawOrder(list, groups, call_bounds) && "A call was moved past one that it overlaps");
+
+    // Rebuild the calls, keeping each group's indices and quads contiguous
+    std::vector<Index> indices;
+    std::vector<Quad> quads;
+    std::vector<DrawCall> calls;
+    indices.reserve(list.indices.size());
+    quads.reserve(list.quads.size());
+    calls.reserve(groups.size());
+
+    for (const Group& group : groups) {
+        DrawCall merged = list.calls[group.calls.front()];
+        merged.index_offset = indices.size();
+        merged.index_count = 0;
+        merged.quad_offset = quads.size();
+        merged.quad_count = 0;
+
+        for (uint32_t c : group.calls) {
+            const DrawCall& call = list.calls[c];
+            indices.insert(indices.end(),
+                list.indices.begin() + call.index_offset,
+                list.indices.begin() + call.index_offset + call.index_count);
+            quads.insert(quads.end(),
+                list.quads.begin() + call.quad_offset,
+                list.quads.begin() + call.quad_offset + call.quad_count);
+            merged.index_count += call.index_count;
+            merged.quad_count += call.quad_count;
+        }
+        calls.emplace_back(merged);
+    }
+
+    list.indices = std::move(indices);
+    list.quads = std::move(quads);
+    list.calls = std::move(calls);
+    return num_saved;
+}
+
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "forward.hpp"
+
+namespace Render2d {
+
+/**
+ * @brief Merge draw calls with identical params, moving later calls back into earlier ones.
+ * A call is only moved back past calls that don't overlap its bounding box, so the result looks the same.
+ * Calls that set shader params are never moved, and never moved past.
+ * @param list A finished draw list. Its indices and quads are rearranged to keep each call contiguous.
+ * @param max_lookback Maximum number of earlier calls to search, which bounds the cost on long lists
+ * @return Number of calls saved
+ */
+size_t ReorderCalls(DrawList& list, size_t max_lookback = 64);
+
+}
@@ -130,6 +130,10 @@ static int GetGlFormat(TextureFormat fmt) {
     }
 }
 
+static bool m_keep_client_copies = false;
+
+void Texture::SetKeepClientCopies(bool keep) { m_keep_client_copies = keep; }
+
 static OglFramebuffer& GetUtilFramebuffer() {
     static OglFramebuffer framebuf;
     return framebuf;
@@ -142,12 +146,23 @@ void Texture::Resize(uint32_t width, uint32_t height) {
 
     m_info.width = width;
     m_info.height = height;
+    if (m_client_copy) {
+        m_client_copy = ClientTexture::Create(m_info);
+        memset(m_client_copy->GetData(), 0, m_info.GetRowStride() * height);
+    }
 }
 
 void Texture::Write(uint32_t x, uint32_t y, uint32_t width, uint32_t height, const void* data) {
     glBindTexture(GL_TEXTURE_2D, GlHandle());
     glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, GetGlFormat(m_info.format), GL_UNSIGNED_BYTE, data);
     glBindTexture(GL_TEXTURE_2D, 0);
+
+    if (m_client_copy && x < m_info.width && y < m_info.height) {
+        const uint32_t row_size = width * m_info.GetPixelStride();
+        const uint32_t copy_size = std::min(width, m_info.width - x) * m_info.GetPixelStride();
+        for (uint32_t row = 0; row < std::min(height, m_info.height - y); ++row)
+            memcpy(m_client_copy->GetPixel(x, y + row), (const uint8_t*)data + row * row_size, copy_size);
+    }
 }
 
 void Texture::ClearColor(float r, float g, float b, float a) {
@@ -158,6 +173,19 @@ void Texture::ClearColor(float r, float g, float b, float a) {
     glClear(GL_COLOR_BUFFER_BIT);
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
     buf.SetColorAttachmentInternal(0, 0);
+
+    if (m_client_copy) {
+        const float rgba[4] = { r, g, b, a };
+        uint8_t pixel[4];
+        for (int i = 0; i < 4; ++i)
+            pixel[i] = (uint8_t)(std::clamp(rgba[i], 0.f, 1.f) * 255.f + 0.5f);
+        // Alpha textures keep only the alpha channel
+        const uint8_t* channels = m_info.format == TextureFormat::A_8_8 ? pixel + 3 : pixel;
+        const uint32_t stride = m_info.GetPixelStride();
+        uint8_t* dst = m_client_copy->GetData();
+        for (uint32_t i = 0; i < m_info.width * m_info.height; ++i, dst += stride)
+            memcpy(dst, channels, stride);
+    }
 }
 
 TexturePtr Texture::Create(const TextureInfo& info, const void* data) {
@@ -190,5 +218,14 @@ TexturePtr Texture::Create(const TextureInfo& info, const void* data) {
         return nullptr;
     }
 
-    return std::make_shared<Texture>(info, id);
+    TexturePtr texture = std::make_shared<Texture>(info, id);
+    if (m_keep_client_copies) {
+        texture->m_client_copy = ClientTexture::Create(info);
+        const size_t size = (size_t)info.GetRowStride() * info.height;
+        if (data)
+            memcpy(texture->m_client_copy->GetData(), data, size);
+        else
+            memset(texture->m_client_copy->GetData(), 0, size);
+    }
+    return texture;
 }
\ No newline at end of file
@@ -103,6 +103,14 @@ public:
     /** Set all pixels to one color */
     void ClearColor(float r, float g, float b, float a);
     GLuint GlHandle() const { return m_handle; }
+    /** @return A copy of the texture's pixels on the client, or `nullptr` if copies weren't kept when it was created */
+    ClientTextureConstPtr GetClientCopy() const { return m_client_copy; }
+
+    /**
+     * @brief Keep a client copy of the pixels of each texture created from now on, and update it on every change.
+     * This doubles the memory of textures, so it's only for renderers that sample textures on the CPU.
+     */
+    static void SetKeepClientCopies(bool keep);
 
     /**
      * @param data Initial data for the texture. If `data == nullptr` then the initial pixels are undefined
@@ -115,4 +123,5 @@ public:
 private:
     const GLuint m_handle;
     TextureInfo m_info;
+    ClientTexturePtr m_client_copy;
 };
\ No newline at end of file
@@ -0,0 +1,94 @@
+#include "transform.hpp"
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define TRANSFORM_SSE2
+    #include <emmintrin.h>
+#elif defined(__wasm_simd128__)
+    #define TRANSFORM_WASM_SIMD
+    #include <wasm_simd128.h>
+#endif
+
+namespace Render2d {
+
+static inline float* PointAt(float* xy, size_t index, size_t stride) {
+    return (float*)((uint8_t*)xy + index * stride);
+}
+
+void TransformPointsScalar(float* xy, size_t count, size_t stride, const glm::mat3& tform) {
+    const float a = tform[0][0], b = tform[0][1];
+    const float c = tform[1][0], d = tform[1][1];
+    const float e = tform[2][0], f = tform[2][1];
+    for (size_t i = 0; i < count; ++i) {
+        float* p = PointAt(xy, i, stride);
+        float x = p[0], y = p[1];
+        p[0] = a * x + c * y + e;
+        p[1] = b * x + d * y + f;
+    }
+}
+
+void TransformPoints(float* xy, size_t count, size_t stride, const glm::mat3& tform) {
+    size_t i = 0;
+
+#if defined(TRANSFORM_SSE2)
+    const __m128 a = _mm_set1_ps(tform[0][0]), b = _mm_set1_ps(tform[0][1]);
+    const __m128 c = _mm_set1_ps(tform[1][0]), d = _mm_set1_ps(tform[1][1]);
+    const __m128 e = _mm_set1_ps(tform[2][0]), f = _mm_set1_ps(tform[2][1]);
+
+    for (; i + 4 <= count; i += 4) {
+        float* p0 = PointAt(xy, i + 0, stride);
+        float* p1 = PointAt(xy, i + 1, stride);
+        float* p2 = PointAt(xy, i + 2, stride);
+        float* p3 = PointAt(xy, i + 3, stride);
+
+        // Gather into { x0 y0 x1 y1 } and { x2 y2 x3 y3 }
+        __m128 p01 = _mm_loadh_pi(_mm_castpd_ps(_mm_load_sd((const double*)p0)), (const __m64*)p1);
+        __m128 p23 = _mm_loadh_pi(_mm_castpd_ps(_mm_load_sd((const double*)p2)), (const __m64*)p3);
+        __m128 xs = _mm_shuffle_ps(p01, p23, _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 ys = _mm_shuffle_ps(p01, p23, _MM_SHUFFLE(3, 1, 3, 1));
+
+        __m128 new_x = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, xs), _mm_mul_ps(c, ys)), e);
+        __m128 new_y = _mm_add_ps(_mm_add_ps(_mm_mul_ps(b, xs), _mm_mul_ps(d, ys)), f);
+
+        // Scatter back to each point
+        __m128 out01 = _mm_unpacklo_ps(new_x, new_y);
+        __m128 out23 = _mm_unpackhi_ps(new_x, new_y);
+        _mm_storel_pi((__m64*)p0, out01);
+        _mm_storeh_pi((__m64*)p1, out01);
+        _mm_storel_pi((__m64*)p2, out23);
+        _mm_storeh_pi((__m64*)p3, out23);
+    }
+#elif defined(TRANSFORM_WASM_SIMD)
+    const v128_t a = wasm_f32x4_splat(tform[0][0]), b = wasm_f32x4_splat(tform[0][1]);
+    const v128_t c = wasm_f32x4_splat(tform[1][0]), d = wasm_f32x4_splat(tform[1][1]);
+    const v128_t e = wasm_f32x4_splat(tform[2][0]), f = wasm_f32x4_splat(tform[2][1]);
+
+    for (; i + 4 <= count; i += 4) {
+        float* p0 = PointAt(xy, i + 0, stride);
+        float* p1 = PointAt(xy, i + 1, stride);
+        float* p2 = PointAt(xy, i + 2, stride);
+        float* p3 = PointAt(xy, i + 3, stride);
+
+        // Gather into { x0 y0 x1 y1 } and { x2 y2 x3 y3 }
+        v128_t p01 = wasm_i64x2_shuffle(wasm_v128_load64_zero(p0), wasm_v128_load64_zero(p1), 0, 2);
+        v128_t p23 = wasm_i64x2_shuffle(wasm_v128_load64_zero(p2), wasm_v128_load64_zero(p3), 0, 2);
+        v128_t xs = wasm_i32x4_shuffle(p01, p23, 0, 2, 4, 6);
+        v128_t ys = wasm_i32x4_shuffle(p01, p23, 1, 3, 5, 7);
+
+        v128_t new_x = wasm_f32x4_add(wasm_f32x4_add(wasm_f32x4_mul(a, xs), wasm_f32x4_mul(c, ys)), e);
+        v128_t new_y = wasm_f32x4_add(wasm_f32x4_add(wasm_f32x4_mul(b, xs), wasm_f32x4_mul(d, ys)), f);
+
+        // Scatter back to each point
+        v128_t out01 = wasm_i32x4_shuffle(new_x, new_y, 0, 4, 1, 5);
+        v128_t out23 = wasm_i32x4_shuffle(new_x, new_y, 2, 6, 3, 7);
+        wasm_v128_store64_lane(p0, out01, 0);
+        wasm_v128_store64_lane(p1, out01, 1);
+        wasm_v128_store64_lane(p2, out23, 0);
+        wasm_v128_store64_lane(p3, out23, 1);
+    }
+#endif
+
+    TransformPointsScalar(PointAt(xy, i, stride), count - i, stride, tform);
+}
+
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include <cstddef>
+#include <glm/mat3x3.hpp>
+
+namespace Render2d {
+
+/**
+ * @brief Transform many 2D points in place, as if by `tform * vec3(x, y, 1)`.
+ * Each point is a pair of floats, and points may be interleaved with other data.
+ * Uses SSE2 or WebAssembly SIMD to process 4 points per step, when available.
+ * @param xy Pointer to the first point's x coordinate. Its y coordinate must follow.
+ * @param count Number of points
+ * @param stride Number of bytes from one point to the next
+ * @param tform Affine transform. The bottom row is ignored.
+ */
+void TransformPoints(float* xy, size_t count, size_t stride, const glm::mat3& tform);
+
+/** Scalar version of @ref TransformPoints, which also handles leftover points */
+void TransformPointsScalar(float* xy, size_t count, size_t stride, const glm::mat3& tform);
+
+}
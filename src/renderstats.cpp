@@ -0,0 +1,164 @@
+#include "renderstats.hpp"
+#include <imgui.h>
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace RenderStats {
+
+using Render2d::FrameStats;
+
+struct Counter {
+    /// @brief Used both as the JSON key and the panel's label
+    const char* name;
+    uint64_t (*get)(const FrameStats& stats);
+};
+
+static constexpr Counter COUNTERS[] = {
+    { "vertices",             [](const FrameStats& s) -> uint64_t { return s.vertices; } },
+    { "indices",              [](const FrameStats& s) -> uint64_t { return s.indices; } },
+    { "quads",                [](const FrameStats& s) -> uint64_t { return s.quads; } },
+    { "draw_calls",           [](const FrameStats& s) -> uint64_t { return s.draw_calls; } },
+    { "shader_param_uploads", [](const FrameStats& s) -> uint64_t { return s.shader_param_uploads; } },
+    { "texture_binds",        [](const FrameStats& s) -> uint64_t { return s.texture_binds; } },
+    { "program_switches",     [](const FrameStats& s) -> uint64_t { return s.program_switches; } },
+    { "scissor_changes",      [](const FrameStats& s) -> uint64_t { return s.scissor_changes; } },
+    { "bytes_uploaded",       [](const FrameStats& s) -> uint64_t { return s.bytes_uploaded; } },
+    { "list_size",            [](const FrameStats& s) -> uint64_t { return s.list_size; } },
+    { "list_capacity",        [](const FrameStats& s) -> uint64_t { return s.list_capacity; } },
+};
+
+/// @brief File written by the panel's export checkbox
+static constexpr const char* DEFAULT_EXPORT_PATH = "render_stats.jsonl";
+
+static std::deque<FrameStats> m_window;
+static uint64_t m_frame_count = 0;
+static std::chrono::steady_clock::time_point m_start_time;
+static FILE* m_export_file = nullptr;
+static std::string m_export_path;
+
+static void ExportFrame(const FrameStats& stats) {
+    const double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start_time).count();
+    fprintf(m_export_file, "{\"frame\":%llu,\"time\":%.4f", (unsigned long long)m_frame_count, time);
+    for (const Counter& counter : COUNTERS)
+        fprintf(m_export_file, ",\"%s\":%llu", counter.name, (unsigned long long)counter.get(stats));
+    fputs("}\n", m_export_file);
+    // Soak tests may be killed at any point, so don't hold lines back
+    fflush(m_export_file);
+}
+
+void Record(const FrameStats& stats) {
+    if (m_frame_count == 0)
+        m_start_time = std::chrono::steady_clock::now();
+    if (m_window.size() >= WINDOW_SIZE)
+        m_window.pop_front();
+    m_window.push_back(stats);
+
+    if (m_export_file)
+        ExportFrame(stats);
+    ++m_frame_count;
+}
+
+const std::deque<FrameStats>& GetWindow() { return m_window; }
+
+bool StartExport(const char* path) {
+    StopExport();
+    const bool is_stdout = std::string(path) == "-";
+    m_export_file = is_stdout ? stdout : fopen(path, "w");
+    if (!m_export_file)
+        return false;
+    m_export_path = is_stdout ? "stdout" : path;
+    return true;
+}
+
+void StopExport() {
+    if (m_export_file && m_export_file != stdout)
+        fclose(m_export_file);
+    else if (m_export_file)
+        fflush(m_export_file);
+    m_export_file = nullptr;
+    m_export_path.clear();
+}
+
+bool IsExporting() { return m_export_file != nullptr; }
+
+void OnImGui(bool* open) {
+    if (!ImGui::Begin("Render stats", open)) {
+        ImGui::End();
+        return;
+    }
+
+    bool exporting = IsExporting();
+    if (ImGui::Checkbox("Export JSON lines", &exporting)) {
+        if (exporting)
+            StartExport(DEFAULT_EXPORT_PATH);
+        else
+            StopExport();
+    }
+    if (IsExporting()) {
+        ImGui::SameLine();
+        ImGui::Text("Writing to %s", m_export_path.c_str());
+    }
+
+    if (m_window.empty()) {
+        ImGui::TextUnformatted("No frames recorded");
+        ImGui::End();
+        return;
+    }
+
+    if (ImGui::BeginTable("counters", 5, ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders | ImGuiTableFlags_SizingFixedFit)) {
+        ImGui::TableSetupColumn("Counter");
+        ImGui::TableSetupColumn("Last");
+        ImGui::TableSetupColumn("Average");
+        ImGui::TableSetupColumn("Min");
+        ImGui::TableSetupColumn("Max");
+        ImGui::TableHeadersRow();
+        for (const Counter& counter : COUNTERS) {
+            uint64_t min = UINT64_MAX, max = 0, sum = 0;
+            for (const FrameStats& stats : m_window) {
+                const uint64_t value = counter.get(stats);
+                min = std::min(min, value);
+                max = std::max(max, value);
+                sum += value;
+            }
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(counter.name);
+            ImGui::TableNextColumn();
+            ImGui::Text("%llu", (unsigned long long)counter.get(m_window.back()));
+            ImGui::TableNextColumn();
+            ImGui::Text("%.1f", (double)sum / m_window.size());
+            ImGui::TableNextColumn();
+            ImGui::Text("%llu", (unsigned long long)min);
+            ImGui::TableNextColumn();
+            ImGui::Text("%llu", (unsigned long long)max);
+        }
+        ImGui::EndTable();
+    }
+
+    // Batching efficiency over the whole window
+    uint64_t vertices = 0, quads = 0, draw_calls = 0;
+    for (const FrameStats& stats : m_window) {
+        vertices += stats.vertices;
+        quads += stats.quads;
+        draw_calls += stats.draw_calls;
+    }
+    const FrameStats& last = m_window.back();
+    ImGui::Text("%.1f vertices and %.1f quads per draw call, draw list uses %.0f%% of its capacity",
+        (double)vertices / std::max<uint64_t>(draw_calls, 1), (double)quads / std::max<uint64_t>(draw_calls, 1),
+        100.0 * last.list_size / std::max<size_t>(last.list_capacity, 1));
+
+    std::vector<float> values(m_window.size());
+    std::transform(m_window.begin(), m_window.end(), values.begin(), [](const FrameStats& s) { return (float)s.draw_calls; });
+    ImGui::PlotLines("Draw calls", values.data(), (int)values.size(), 0, nullptr, 0.f, FLT_MAX, ImVec2(0, 60));
+    std::transform(m_window.begin(), m_window.end(), values.begin(), [](const FrameStats& s) { return s.bytes_uploaded / 1024.f; });
+    ImGui::PlotLines("KB uploaded", values.data(), (int)values.size(), 0, nullptr, 0.f, FLT_MAX, ImVec2(0, 60));
+
+    ImGui::End();
+}
+
+}
@@ -0,0 +1,34 @@
+/**
+ * @file renderstats.hpp
+ * @brief Rolling window of @ref Render2d::FrameStats, with an ImGui panel and JSON lines export
+ *
+ * Each recorded frame can be written as one JSON object per line, so long runs can be graphed afterwards.
+ * Set the environment variable `GLAP_RENDER_STATS` to a file path, or to `-` for stdout, to export from startup.
+ */
+
+#pragma once
+#include <render/render2d.hpp>
+#include <cstddef>
+#include <deque>
+
+namespace RenderStats {
+    /// @brief Number of frames kept in the window
+    static constexpr size_t WINDOW_SIZE = 600;
+
+    /** Add a frame to the window, and export it if @ref StartExport was called */
+    void Record(const Render2d::FrameStats& stats);
+    /// @return The last @ref WINDOW_SIZE frames, oldest first
+    const std::deque<Render2d::FrameStats>& GetWindow();
+
+    /**
+     * @brief Write each following frame as a line of JSON. Any previous export is stopped.
+     * @param path File to write, or `-` for stdout
+     * @return `false` if the file couldn't be opened
+     */
+    bool StartExport(const char* path);
+    void StopExport();
+    bool IsExporting();
+
+    /** Show the panel, with each counter's last, average and peak value over the window */
+    void OnImGui(bool* open = nullptr);
+}
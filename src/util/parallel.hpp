@@ -0,0 +1,152 @@
+#pragma once
+#include <cstddef>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @brief Maximum number of threads that @ref ParallelFor runs on, including the calling thread.
+ * This is `1` on platforms without threads, such as Emscripten without pthreads.
+ */
+inline size_t GetParallelism() {
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+    return 1;
+#else
+    return std::max(1u, std::thread::hardware_concurrency());
+#endif
+}
+
+#if !defined(__EMSCRIPTEN__) || defined(__EMSCRIPTEN_PTHREADS__)
+/**
+ * @brief Worker threads that are started on first use and kept for the rest of the program, so @ref ParallelFor
+ * doesn't create threads on every call. Jobs run one at a time. A job started from inside another runs on the calling thread.
+ */
+class WorkerPool {
+public:
+    static WorkerPool& Get() {
+        static WorkerPool pool;
+        return pool;
+    }
+
+    /** Call `fn(context, i)` for each `i` in `[0, count)` on every worker and the calling thread, and wait for them all */
+    void Run(size_t count, void (*fn)(void*, size_t), void* context) {
+        if (t_is_in_job) {
+            for (size_t i = 0; i < count; ++i)
+                fn(context, i);
+            return;
+        }
+
+        std::lock_guard run_lock(m_run_mutex);
+        t_is_in_job = true;
+        {
+            std::lock_guard lock(m_mutex);
+            m_fn = fn;
+            m_context = context;
+            m_count = count;
+            m_next = 0;
+            m_busy_workers = m_workers.size();
+            ++m_generation;
+        }
+        m_wake.notify_all();
+
+        Work();
+        {
+            std::unique_lock lock(m_mutex);
+            m_done.wait(lock, [this] { return m_busy_workers == 0; });
+        }
+        t_is_in_job = false;
+    }
+
+private:
+    WorkerPool() {
+        const size_t num_workers = GetParallelism() - 1;
+        m_workers.reserve(num_workers);
+        for (size_t t = 0; t < num_workers; ++t)
+            m_workers.emplace_back([this] { WorkerLoop(); });
+    }
+
+    ~WorkerPool() {
+        {
+            std::lock_guard lock(m_mutex);
+            m_is_stopping = true;
+        }
+        m_wake.notify_all();
+        for (std::thread& worker : m_workers)
+            worker.join();
+    }
+
+    void WorkerLoop() {
+        t_is_in_job = true;
+        uint64_t generation = 0;
+        for (;;) {
+            {
+                std::unique_lock lock(m_mutex);
+                m_wake.wait(lock, [&] { return m_is_stopping || m_generation != generation; });
+                if (m_is_stopping)
+                    return;
+                generation = m_generation;
+            }
+
+            Work();
+            bool is_last;
+            {
+                std::lock_guard lock(m_mutex);
+                is_last = --m_busy_workers == 0;
+            }
+            if (is_last)
+                m_done.notify_one();
+        }
+    }
+
+    /** Take indices of the current job until there are none left */
+    void Work() {
+        for (size_t i; (i = m_next.fetch_add(1, std::memory_order_relaxed)) < m_count;)
+            m_fn(m_context, i);
+    }
+
+    /// @brief True on workers, and on a thread that is running a job, so nested jobs don't wait on themselves
+    static inline thread_local bool t_is_in_job = false;
+
+    std::vector<std::thread> m_workers;
+    /// @brief Held for the whole of a job, so jobs from different threads take turns
+    std::mutex m_run_mutex;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+    bool m_is_stopping = false;
+    /// @brief Changes for each new job, which wakes the workers
+    uint64_t m_generation = 0;
+    size_t m_busy_workers = 0;
+
+    void (*m_fn)(void*, size_t) = nullptr;
+    void* m_context = nullptr;
+    size_t m_count = 0;
+    std::atomic<size_t> m_next = 0;
+};
+#endif
+
+/**
+ * @brief Call `fn(i)` for each `i` in `[0, count)`, spread across the threads of the @ref WorkerPool.
+ * The calling thread also does work, and returns once every call is complete.
+ * Calls run in no particular order, so they must not depend on each other.
+ */
+template <class Fn>
+void ParallelFor(size_t count, Fn&& fn) {
+    size_t num_threads = std::min(GetParallelism(), count);
+    if (num_threads <= 1) {
+        for (size_t i = 0; i < count; ++i)
+            fn(i);
+        return;
+    }
+
+#if !defined(__EMSCRIPTEN__) || defined(__EMSCRIPTEN_PTHREADS__)
+    using FnType = std::remove_reference_t<Fn>;
+    WorkerPool::Get().Run(count, [](void* context, size_t i) { (*static_cast<FnType*>(context))(i); },
+        const_cast<void*>(static_cast<const void*>(&fn)));
+#endif
+}
@@ -0,0 +1,124 @@
+#pragma once
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include <algorithm>
+#include <glm/vec2.hpp>
+#include <glm/common.hpp>
+
+/**
+ * @brief Uniform grid of axis-aligned rectangles, for finding items near a point or within a view.
+ * Each item is listed in every cell that its rectangle touches.
+ * Moving an item within the same cells only updates its rectangle.
+ * @tparam T A hashable item handle, such as a pointer
+ */
+template <class T>
+class SpatialGrid {
+public:
+    /// @param cell_size Width and height of each cell. Items should be around this size or smaller.
+    explicit SpatialGrid(float cell_size) : m_cell_size(cell_size) {}
+
+    /**
+     * @brief Add an item, or move it if it already exists
+     * @param min Top-left corner of its rectangle
+     * @param max Bottom-right corner of its rectangle
+     */
+    void Update(const T& item, glm::vec2 min, glm::vec2 max) {
+        const CellRange cells = GetCells(min, max);
+        auto [it, inserted] = m_items.try_emplace(item);
+        Entry& entry = it->second;
+        entry.min = min;
+        entry.max = max;
+        if (!inserted && entry.cells == cells)
+            return;
+
+        if (!inserted)
+            RemoveFromCells(item, entry.cells);
+        entry.cells = cells;
+        for (int32_t y = cells.min.y; y <= cells.max.y; ++y) {
+            for (int32_t x = cells.min.x; x <= cells.max.x; ++x)
+                m_cells[CellKey(x, y)].push_back(item);
+        }
+    }
+
+    /// @return `false` if the item doesn't exist
+    bool Remove(const T& item) {
+        auto it = m_items.find(item);
+        if (it == m_items.end())
+            return false;
+        RemoveFromCells(item, it->second.cells);
+        m_items.erase(it);
+        return true;
+    }
+
+    void Clear() {
+        m_items.clear();
+        m_cells.clear();
+    }
+
+    size_t Size() const { return m_items.size(); }
+
+    /**
+     * @brief Call `fn(item)` once for each item whose rectangle intersects `[min, max]`.
+     * Items are found in no particular order.
+     */
+    template <class Fn>
+    void Query(glm::vec2 min, glm::vec2 max, Fn&& fn) const {
+        const CellRange query = GetCells(min, max);
+        for (int32_t y = query.min.y; y <= query.max.y; ++y) {
+            for (int32_t x = query.min.x; x <= query.max.x; ++x) {
+                auto cell = m_cells.find(CellKey(x, y));
+                if (cell == m_cells.end())
+                    continue;
+
+                for (const T& item : cell->second) {
+                    const Entry& entry = m_items.find(item)->second;
+                    // Items that span several cells are only reported from the first one that the query visits
+                    if (x != std::max(entry.cells.min.x, query.min.x) || y != std::max(entry.cells.min.y, query.min.y))
+                        continue;
+                    if (entry.max.x < min.x || entry.min.x > max.x || entry.max.y < min.y || entry.min.y > max.y)
+                        continue;
+                    fn(item);
+                }
+            }
+        }
+    }
+
+private:
+    struct CellRange {
+        glm::ivec2 min, max;
+        bool operator==(const CellRange& other) const { return min == other.min && max == other.max; }
+    };
+
+    struct Entry {
+        glm::vec2 min, max;
+        CellRange cells;
+    };
+
+    CellRange GetCells(glm::vec2 min, glm::vec2 max) const {
+        return CellRange {
+            glm::ivec2(glm::floor(min / m_cell_size)),
+            glm::ivec2(glm::floor(max / m_cell_size)),
+        };
+    }
+
+    static uint64_t CellKey(int32_t x, int32_t y) { return (uint64_t)(uint32_t)x << 32 | (uint32_t)y; }
+
+    void RemoveFromCells(const T& item, const CellRange& cells) {
+        for (int32_t y = cells.min.y; y <= cells.max.y; ++y) {
+            for (int32_t x = cells.min.x; x <= cells.max.x; ++x) {
+                auto cell = m_cells.find(CellKey(x, y));
+                std::vector<T>& items = cell->second;
+                auto it = std::find(items.begin(), items.end(), item);
+                *it = items.back();
+                items.pop_back();
+                if (items.empty())
+                    m_cells.erase(cell);
+            }
+        }
+    }
+
+    float m_cell_size;
+    std::unordered_map<T, Entry> m_items;
+    std::unordered_map<uint64_t, std::vector<T>> m_cells;
+};